@@ -10,6 +10,8 @@
 extern "C" {
 #endif
 
+#include <stdarg.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -49,7 +51,12 @@ extern "C" {
 # define SENARENA_DEFAULT_CHUNK_SIZE (4 * 1024 - sizeof(struct senarena_chunk_header))
 #endif
 
+#ifndef SENARENA_DEFAULT_MAX_CHUNK_SIZE
+# define SENARENA_DEFAULT_MAX_CHUNK_SIZE (64 * 1024 * 1024 - sizeof(struct senarena_chunk_header))
+#endif
+
 #define SENARENA_MIN(a, b) ((a) <= (b) ? (a) : (b))
+#define SENARENA_MAX(a, b) ((a) >= (b) ? (a) : (b))
 
 #define SENARENA_SIMPLE_ALIGNOF(t) (sizeof(t) <= 1 ? 1 : offsetof(struct { char c; t x; }, x))
 
@@ -60,6 +67,61 @@ extern "C" {
 struct senarena_chunk_header {
   struct senarena_chunk_header *ptr;
   uintptr_t capacity;
+  // the chunk whose ptr refers to this one (only valid for used chunks)
+  struct senarena_chunk_header *newer;
+  // the bytes between the end of this header and here are known to be zero
+  // (the arena keeps this for its current chunk)
+  uintptr_t zeroed;
+};
+
+struct senarena_region;
+
+#ifndef SENARENA_CLEANUP_BATCH
+# define SENARENA_CLEANUP_BATCH 8
+#endif
+
+struct senarena_cleanup {
+  void (*fn)(void *context);
+  void *context;
+};
+
+// Cleanup callbacks are stored in the arena, a batch at a time
+struct senarena_cleanups {
+  // the batch registered before this one
+  struct senarena_cleanups *next;
+  unsigned count;
+  struct senarena_cleanup entries[SENARENA_CLEANUP_BATCH];
+};
+
+// Only collected when SENARENA_STATS is defined, which it has to be for
+// both sensible-arena, and the units that include this header.
+struct senarena_stats {
+  // bytes allocated since the last clear, including dedicated chunks
+  size_t live_bytes;
+  // alignment padding since the last clear
+  size_t padding_bytes;
+  // peak live_bytes
+  size_t peak_live_bytes;
+  // chunks owned by the arena, including dedicated and reusable ones
+  size_t chunks;
+  // chunks allocated for a single large allocation
+  size_t dedicated_chunks;
+  // times a reusable chunk was used, rather than allocating one
+  size_t fresh_chunk_reuses;
+};
+
+// Supplies an arena's chunks, instead of its backend.
+// Allocations from an arena with an allocator return NULL when alloc does,
+// rather than exiting, and the arena stays usable. If even its first chunk
+// fails, the arena starts out without one (bottom is 0), and tries again
+// on its next allocation.
+struct senarena_allocator {
+  // Returns NULL on failure. Chunks have to be aligned to at least
+  // SENARENA_ALIGNOF(struct senarena_chunk_header).
+  void *(*alloc)(void *context, size_t size);
+  // NULL if chunks are freed along with the allocator, like a parent arena's
+  void (*free)(void *context, void *ptr, size_t size);
+  void *context;
 };
 
 struct senarena {
@@ -67,27 +129,399 @@ struct senarena {
   uintptr_t top;
   // pointer to the current chunk (after the header)
   uintptr_t bottom;
+  // the bytes between bottom and the lower of this and top are known to be
+  // zero, like pages fresh from mmap
+  uintptr_t zeroed;
   // pointer to the next reusable chunk
   struct senarena_chunk_header *fresh_chunks;
+  // the end of the used chain, so that it can be spliced onto the
+  // reusable chunks without walking it
+  struct senarena_chunk_header *oldest;
+  // the chunk in the caller's buffer, which we never free, or NULL
+  struct senarena_chunk_header *buffer;
+  // the newest batch of cleanup callbacks, or NULL
+  struct senarena_cleanups *cleanups;
+  // mmap backend: the region new chunks are carved from
+  // malloc backend: NULL
+  struct senarena_region *regions;
+  // alloc is NULL, unless the chunks come from an allocator
+  struct senarena_allocator allocator;
+  // capacity of the next new chunk
+  size_t chunk_size;
+  // chunks stop growing at this capacity
+  size_t max_chunk_size;
+  unsigned growth_factor;
+  // the largest alignment an allocation has needed a new chunk for, and
+  // filled at least half of, since the last clear, if chunks for several
+  // of them fit in max_chunk_size. New chunks are made big enough for those.
+  size_t max_alignment;
+#ifdef SENARENA_STATS
+  struct senarena_stats stats;
+#endif
+};
+
+enum senarena_backend {
+  // one malloc() per chunk
+  SENARENA_BACKEND_MALLOC,
+  // chunks are carved out of large mmap()ed regions
+  SENARENA_BACKEND_MMAP,
 };
 
+struct senarena_config {
+  enum senarena_backend backend;
+  // Ask for transparent huge pages (mmap backend only)
+  bool huge_pages;
+  // Capacity of the first chunk (0 for SENARENA_DEFAULT_CHUNK_SIZE)
+  size_t chunk_size;
+  // Each new chunk (including its header) is this many times bigger than
+  // the last (0 or 1 for fixed-size chunks)
+  unsigned growth_factor;
+  // Chunks stop growing at this capacity (0 for SENARENA_DEFAULT_MAX_CHUNK_SIZE)
+  size_t max_chunk_size;
+  // Overrides the backend, unless alloc is NULL
+  struct senarena_allocator allocator;
+};
 
+// Takes over the chunks of an arena freed by senarena_free_deferred, if
+// there are any: its most recently used chunk becomes the current one, and
+// the rest are reusable. Those are all default-sized, malloced chunks, so
+// the arena is just like one with the default config otherwise, and new
+// chunks it needs are the default size too. Only senarena_new (and so
+// senarena_new_with_buffer, for buffers too small to use) takes chunks
+// over; senarena_new_with_config always starts with a chunk of its own,
+// from the config's allocator or backend, and of its chunk size.
 senmac_public struct senarena senarena_new();
+// With an allocator, the arena's bottom is 0 if its first chunk couldn't be
+// allocated. It can still be freed.
+senmac_public struct senarena senarena_new_with_config(struct senarena_config config);
+// Uses buf as the first chunk, and default chunks from the heap once it's
+// full. buf has to outlive the arena, which never frees it.
+senmac_public struct senarena senarena_new_with_buffer(void *buf, size_t len);
 
 #if defined(SENARENA_NOINLINE) && !defined(SENARENA_IMPL)
 senmac_public void *senarena_alloc(struct senarena *restrict arena, size_t byte_amount, size_t alignment) senarena_malloc;
+// Like senarena_alloc, but the bytes are zeroed, unless they're known to be
+// zero already
+senmac_public void *senarena_alloc_zeroed(struct senarena *restrict arena, size_t byte_amount, size_t alignment) senarena_malloc;
 #endif
 senmac_public void senarena_clear(struct senarena *restrict arena);
 senmac_public void senarena_free(struct senarena arena);
+// Like senarena_free, but hands the arena's chunks over, to be reused by
+// the next senarena_new, or freed later, by senarena_reclaim or the
+// reclaimer thread. Cleanups still run right away. Arenas with an
+// allocator, a caller's buffer, or the mmap backend are freed right away.
+senmac_public void senarena_free_deferred(struct senarena arena);
+// Frees the chunks senarena_free_deferred handed over, and returns how
+// many there were. Call it at a point where the time doesn't matter.
+senmac_public size_t senarena_reclaim(void);
+// Starts a thread that frees handed over chunks as they come in.
+// Returns false if it couldn't be started.
+senmac_public bool senarena_reclaimer_start(void);
+// Stops the reclaimer thread, once it's freed everything handed over
+senmac_public void senarena_reclaimer_stop(void);
+// Registers fn to be called with context when the arena is cleared or
+// freed (or rewound to a mark taken before this), most recent first.
+// The callback is stored in the arena, and mustn't allocate from it.
+// Returns false, without registering fn, if the arena's allocator failed.
+senmac_public bool senarena_on_clear(struct senarena *restrict arena, void (*fn)(void *context), void *context);
+// A savepoint. Rewinding to it frees everything allocated after it was taken.
+// Rewinding invalidates marks taken after this one, and clearing the arena
+// invalidates all marks.
+struct senarena_mark {
+  uintptr_t top;
+  uintptr_t bottom;
+  // the current chunk's ptr when the mark was taken
+  struct senarena_chunk_header *previous;
+  struct senarena_cleanups *cleanups;
+  unsigned cleanup_count;
+#ifdef SENARENA_STATS
+  size_t live_bytes;
+  size_t padding_bytes;
+#endif
+};
+
+senmac_public struct senarena_mark senarena_mark(const struct senarena *restrict arena);
+senmac_public void senarena_rewind(struct senarena *restrict arena, struct senarena_mark mark);
+
+// Resizes an allocation of old_amount bytes to new_amount bytes, keeping its
+// contents (up to the smaller of the two sizes), and returns its new address.
+// If ptr was the most recent allocation, and the current chunk has room,
+// it's resized in place, at the top of the arena. Otherwise, this allocates
+// and copies, and returns NULL (leaving ptr alone) if that fails.
+senmac_public void *senarena_realloc_last(struct senarena *restrict arena, void *ptr, size_t old_amount, size_t new_amount, size_t alignment);
+
+// A growable buffer, which lives at the top of an arena, and grows in place
+// as long as nothing else is allocated in that arena before it's finished.
+struct senarena_buf {
+  struct senarena *arena;
+  unsigned char *data;
+  // bytes in use
+  size_t length;
+  // bytes allocated
+  size_t capacity;
+  size_t alignment;
+};
+
+senmac_public struct senarena_buf senarena_buf_new(struct senarena *restrict arena, size_t alignment);
+// Grows the buffer by amount bytes, and returns a pointer to them, or NULL
+// (leaving the buffer alone) if the arena's allocator failed
+senmac_public void *senarena_buf_reserve(struct senarena_buf *restrict buf, size_t amount);
+// Returns false if the arena's allocator failed
+senmac_public bool senarena_buf_append(struct senarena_buf *restrict buf, const void *restrict data, size_t amount);
+// Shrinks the buffer to its length, and returns its data, which is then
+// owned by the arena
+senmac_public void *senarena_buf_finish(struct senarena_buf *restrict buf);
+
+// String builders are growable buffers of chars, which are NUL-terminated
+// when they're finished. The functions that add to them return false if
+// the arena's allocator failed.
+senmac_public struct senarena_buf senarena_str_new(struct senarena *restrict arena);
+senmac_public bool senarena_str_append(struct senarena_buf *restrict buf, const char *restrict str);
+senmac_public bool senarena_str_printf(struct senarena_buf *restrict buf, const char *restrict fmt, ...) HEDLEY_PRINTF_FORMAT(2, 3);
+senmac_public bool senarena_str_vprintf(struct senarena_buf *restrict buf, const char *restrict fmt, va_list args);
+// Returns the string, or NULL if the arena's allocator failed.
+// buf->length is its length, not counting the NUL.
+senmac_public char *senarena_str_finish(struct senarena_buf *restrict buf);
+// Formats a string in the arena, or returns NULL if its allocator failed
+senmac_public char *senarena_sprintf(struct senarena *restrict arena, const char *restrict fmt, ...) HEDLEY_PRINTF_FORMAT(2, 3);
+
+// Interns strings in an arena, so that equal strings have the same address.
+// Its table lives in the arena too, so clearing (or rewinding past) the
+// arena invalidates the interner.
+struct senarena_interned {
+  // NULL for empty slots
+  const char *str;
+  size_t length;
+  size_t hash;
+};
+
+struct senarena_interner {
+  struct senarena *arena;
+  // open addressing, with linear probing
+  struct senarena_interned *slots;
+  // a power of two, or 0
+  size_t capacity;
+  size_t count;
+};
+
+senmac_public struct senarena_interner senarena_interner_new(struct senarena *restrict arena);
+// Returns the interned copy of length bytes at str, which is NUL-terminated,
+// copying them into the arena if they're new. Returns NULL if the arena's
+// allocator failed.
+senmac_public const char *senarena_intern(struct senarena_interner *restrict interner, const char *str, size_t length);
+// Finishes a string builder, and interns the result. If it was interned
+// already, the builder's memory is handed back to its arena (as long as
+// nothing was allocated after it), and the builder is left empty.
+senmac_public const char *senarena_intern_str(struct senarena_interner *restrict interner, struct senarena_buf *restrict buf);
+
+// Allocates count objects of amount bytes each, with one bounds check per
+// chunk rather than per object, and stores their addresses in out.
+// Objects are contiguous within each chunk, and spill over into new
+// chunks, so they aren't necessarily contiguous overall.
+// Returns the number allocated, which is less than count only if the
+// arena's allocator failed.
+senmac_public size_t senarena_alloc_batch(struct senarena *restrict arena, size_t amount, size_t alignment, size_t count, void **restrict out);
+// Allocates count objects of amount bytes each, contiguously, each one
+// aligned. Returns NULL if the total size overflows, or the arena's
+// allocator failed.
+senmac_public void *senarena_alloc_contiguous(struct senarena *restrict arena, size_t amount, size_t alignment, size_t count);
+
+// Makes sure the current chunk has at least amount contiguous free bytes
+// (including any alignment padding), so that allocating them never leaves
+// the inlined fast path. Switches to the first reusable chunk that's big
+// enough, or a new one, abandoning the rest of the current chunk.
+// Returns false if the arena's allocator failed.
+senmac_public bool senarena_reserve(struct senarena *restrict arena, size_t amount);
+
+// All zeroes, unless SENARENA_STATS is defined
+senmac_public struct senarena_stats senarena_stats(const struct senarena *restrict arena);
+
+// Gives the memory of reusable chunks back to the system
+senmac_public void senarena_trim(struct senarena *restrict arena);
+// An allocator that takes chunks from a parent arena, which has to outlive
+// the child. They're freed when the parent is cleared or freed.
+senmac_public struct senarena_allocator senarena_parent_allocator(struct senarena *restrict parent);
 senmac_public uintptr_t senarena_alloc_more(struct senarena *restrict arena, size_t amount, size_t alignment);
+senmac_public uintptr_t senarena_alloc_zeroed_more(struct senarena *restrict arena, size_t amount, size_t alignment);
+
+// Process-wide pool of default-sized chunks, shared between arenas.
+// Arenas draw chunks from the pool, and senarena_free returns them to it,
+// until it holds max_retained_bytes. The pool is lock-free.
+// It's disabled by default (a capacity of zero), and lowering the
+// capacity releases pooled chunks back to the system, except those another
+// thread might be reading, while it takes a chunk, which a later call
+// releases. The pool may briefly hold more than its capacity because of
+// those.
+struct senarena_pool_stats {
+  // bytes held by the pool, including chunk headers
+  size_t retained_bytes;
+  // chunk requests served by the pool
+  uint64_t hits;
+  // chunk requests the pool couldn't serve, which went to malloc
+  uint64_t misses;
+};
+
+senmac_public void senarena_pool_set_capacity(size_t max_retained_bytes);
+senmac_public struct senarena_pool_stats senarena_pool_stats(void);
+
+// Thread-local arenas.
+// Each thread lazily creates its own arena on first use, which is freed
+// when the thread exits (or explicitly, with senarena_thread_local_free).
+senmac_public struct senarena *senarena_thread_local(void);
+senmac_public void senarena_thread_local_free(void);
+// Arenas that senarena_thread_local creates from now on use config.
+// Set it before threads start using their arenas.
+senmac_public void senarena_thread_local_set_config(struct senarena_config config);
+
+// Scopes nest. Ending a scope frees everything allocated in it, and when
+// the outermost scope on a thread ends, that thread's arena is cleared.
+// senarena_scope_begin returns NULL, without beginning a scope (so there's
+// none to end), if the arena's allocator can't supply a chunk for it.
+senmac_public struct senarena *senarena_scope_begin(void);
+senmac_public void senarena_scope_end(void);
+// The calling thread's arena, if it's inside a scope, or NULL
+senmac_public struct senarena *senarena_scope_arena(void);
+
+// A self-relative pointer, which holds the distance from itself to its
+// target, so it stays valid when the memory holding both moves, like an
+// arena image that's saved and loaded again. It can't point to itself.
+struct senarena_relptr {
+  // 0 for NULL
+  intptr_t offset;
+};
+
+static senarena_always_inline
+void senarena_relptr_set(struct senarena_relptr *restrict rel, const void *target) {
+  rel->offset = target == NULL ? 0 : (intptr_t) ((uintptr_t) target - (uintptr_t) rel);
+}
+
+static senarena_always_inline
+void *senarena_relptr_get(const struct senarena_relptr *rel) {
+  return rel->offset == 0 ? NULL : (void*) ((uintptr_t) rel + (uintptr_t) rel->offset);
+}
+
+// Arena images.
+// An image's arena carves all its chunks out of one reservation of
+// capacity bytes, which can be saved to a file, and mapped back in,
+// read-only, by any process. Everything in an image has to refer to the
+// rest of it with relative pointers, and be at most page-aligned.
+struct senarena_image {
+  // allocate the image's contents here
+  struct senarena arena;
+  // the start of the reservation, or NULL if it couldn't be made
+  void *base;
+  size_t capacity;
+};
+
+// A saved image, mapped into memory
+struct senarena_loaded_image {
+  // the root passed to senarena_image_save, or NULL
+  const void *root;
+  // the start of the mapping, or NULL if the image couldn't be loaded
+  const void *base;
+  size_t size;
+};
+
+senmac_public struct senarena_image senarena_image_new(size_t capacity);
+// Bytes senarena_image_save would write
+senmac_public size_t senarena_image_size(const struct senarena_image *restrict image);
+// Writes the image to path, with root (which has to be in the image, or
+// NULL) as its entry point. Returns false if that fails.
+senmac_public bool senarena_image_save(const struct senarena_image *restrict image, const void *root, const char *path);
+senmac_public void senarena_image_free(struct senarena_image image);
+// Maps the image saved at path. base is NULL if it couldn't be read, or was
+// saved by an incompatible build.
+senmac_public struct senarena_loaded_image senarena_image_load(const char *path);
+senmac_public void senarena_image_unload(struct senarena_loaded_image image);
+
+// Frame arenas.
+// Owns one arena per frame in flight. Advancing to the next frame clears
+// the oldest frame's arena, and makes it the current one, so data made
+// in frame N lives until frame N + frames.
+#ifndef SENFRAME_MAX_FRAMES
+# define SENFRAME_MAX_FRAMES 8
+#endif
+
+struct senframe {
+  struct senarena arenas[SENFRAME_MAX_FRAMES];
+  // arenas in use
+  unsigned frames;
+  // index of the current frame's arena
+  unsigned current;
+};
+
+// frames has to be between 2 and SENFRAME_MAX_FRAMES
+senmac_public struct senframe senframe_new(unsigned frames);
+senmac_public struct senframe senframe_new_with_config(unsigned frames, struct senarena_config config);
+// The arena of the frame age frames ago (0 for the current one).
+// age has to be less than frames.
+senmac_public struct senarena *senframe_arena(struct senframe *restrict frame, unsigned age);
+// Clears the oldest frame's arena, and returns it, as the new current arena
+senmac_public struct senarena *senframe_advance(struct senframe *restrict frame);
+senmac_public void senframe_free(struct senframe frame);
 
 #define senarena_alloc_type(arena, type) senarena_alloc((arena), sizeof(type), SENARENA_ALIGNOF(type))
 #define senarena_alloc_array_of(arena, type, amount) senarena_alloc(arena, sizeof(type) * amount, SENARENA_ALIGNOF(type))
+#define senarena_calloc_array_of(arena, type, amount) senarena_alloc_zeroed(arena, sizeof(type) * amount, SENARENA_ALIGNOF(type))
+
+// Defines allocators for one type, whose size and alignment are constants,
+// so that the new top is one subtraction and one mask away:
+//
+//   static type *name(struct senarena *arena);
+//   // NULL if count objects overflow, or the arena's allocator failed
+//   static type *name_array(struct senarena *arena, size_t count);
+//
+// They return the same memory senarena_alloc_type and
+// senarena_alloc_contiguous would, and fall back to them when the current
+// chunk is full, or the arena has no chunk.
+#ifdef SENARENA_STATS
+# define SENARENA_DEFINE_ALLOCATOR_STATS(arena, new_top, amount)                \
+  (arena)->stats.live_bytes += (amount);                                      \
+  (arena)->stats.padding_bytes += (arena)->top - (new_top) - (amount);
+#else
+# define SENARENA_DEFINE_ALLOCATOR_STATS(arena, new_top, amount)
+#endif
+
+#define SENARENA_DEFINE_ALLOCATOR(name, type)                                  \
+  static senarena_always_inline senarena_malloc                               \
+  type *name(struct senarena *restrict arena) {                               \
+    /* before subtracting, which would wrap in an arena without a chunk */   \
+    if senarena_unlikely((size_t) (arena->top - arena->bottom) < sizeof(type)) { \
+      return (type*) senarena_alloc_more(arena, sizeof(type), SENARENA_ALIGNOF(type)); \
+    }                                                                         \
+    const uintptr_t top = SENARENA_ALIGN_DOWN(arena->top - sizeof(type), SENARENA_ALIGNOF(type)); \
+    /* chunks start at least header-aligned, so aligning down can't cross */ \
+    /* bottom, unless the type is more aligned than that */                  \
+    if senarena_unlikely(SENARENA_ALIGNOF(type) > SENARENA_ALIGNOF(struct senarena_chunk_header) && top < arena->bottom) { \
+      return (type*) senarena_alloc_more(arena, sizeof(type), SENARENA_ALIGNOF(type)); \
+    }                                                                         \
+    SENARENA_DEFINE_ALLOCATOR_STATS(arena, top, sizeof(type))                 \
+    arena->top = top;                                                         \
+    return (type*) top;                                                       \
+  }                                                                           \
+                                                                              \
+  static senarena_always_inline senarena_malloc                               \
+  type *name##_array(struct senarena *restrict arena, size_t count) {         \
+    /* a constant bound, rather than a division, and the room before */     \
+    /* subtracting, like name */                                             \
+    const size_t amount = count * sizeof(type);                               \
+    if senarena_unlikely(count > SIZE_MAX / sizeof(type) || (size_t) (arena->top - arena->bottom) < amount) { \
+      return (type*) senarena_alloc_contiguous(arena, sizeof(type), SENARENA_ALIGNOF(type), count); \
+    }                                                                         \
+    const uintptr_t top = SENARENA_ALIGN_DOWN(arena->top - amount, SENARENA_ALIGNOF(type)); \
+    if senarena_unlikely(SENARENA_ALIGNOF(type) > SENARENA_ALIGNOF(struct senarena_chunk_header) && top < arena->bottom) { \
+      return (type*) senarena_alloc_contiguous(arena, sizeof(type), SENARENA_ALIGNOF(type), count); \
+    }                                                                         \
+    SENARENA_DEFINE_ALLOCATOR_STATS(arena, top, amount)                       \
+    arena->top = top;                                                         \
+    return (type*) top;                                                       \
+  }
 
 #if defined(SENARENA_IMPL) || !defined(SENARENA_NOINLINE)
 
 #include <assert.h>
 #include <stdbool.h>
+#include <string.h>
 
 static senarena_always_inline
 uintptr_t senarena_extra_bytes_needed(uintptr_t ptr, uintptr_t alignment) {
@@ -125,6 +559,42 @@ void *senarena_alloc(struct senarena *restrict arena, size_t amount, size_t alig
     return (void*) senarena_alloc_more(arena, amount, alignment);
   }
   arena->top -= amount_and_padding;
+#ifdef SENARENA_STATS
+  arena->stats.live_bytes += amount;
+  arena->stats.padding_bytes += amount_and_padding - amount;
+#endif
+  return (void*) arena->top;
+}
+
+// Zeroes the bytes of [start, start + amount) that aren't below zeroed
+static senarena_always_inline
+void senarena_zero_unknown(uintptr_t start, size_t amount, uintptr_t zeroed) {
+  const uintptr_t end = start + amount;
+  if senarena_likely(end > zeroed) {
+    const uintptr_t from = SENARENA_MAX(start, zeroed);
+    memset((void*) from, 0, end - from);
+  }
+}
+
+#ifndef SENARENA_IMPL
+extern senarena_always_inline
+#endif
+senarena_malloc
+void *senarena_alloc_zeroed(struct senarena *restrict arena, size_t amount, size_t alignment) {
+  assert(alignment > 0 && !(alignment & (alignment - 1)));
+  const uintptr_t top = arena->top;
+  const size_t amount_and_padding = amount + senarena_extra_bytes_needed(top - amount, alignment);
+  if senarena_unlikely(amount_and_padding > top - arena->bottom) {
+    return (void*) senarena_alloc_zeroed_more(arena, amount, alignment);
+  }
+  // everything above top has been handed out already
+  const uintptr_t zeroed = SENARENA_MIN(arena->zeroed, top);
+  arena->top = top - amount_and_padding;
+#ifdef SENARENA_STATS
+  arena->stats.live_bytes += amount;
+  arena->stats.padding_bytes += amount_and_padding - amount;
+#endif
+  senarena_zero_unknown(arena->top, amount, zeroed);
   return (void*) arena->top;
 }
 
@@ -0,0 +1,68 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <assert.h>
+
+#include "sensible-macros.h"
+
+// The fast path is defined in sensible-arena.c
+#ifndef SENARENA_NOINLINE
+# define SENARENA_NOINLINE
+#endif
+#include "../include/sensible-arena.h"
+
+// The arenas form a ring. The current frame's arena is at `current`, and
+// the one after it (wrapping around) is the oldest, so advancing steps
+// `current` forward, onto the oldest arena, and clears it.
+//
+//        current
+//           v
+//   | N - 1 | N | N - 3 | N - 2 |
+//                   ^
+//                 oldest
+
+senmac_public
+struct senframe senframe_new_with_config(unsigned frames, struct senarena_config config) {
+  assert(frames >= 2 && frames <= SENFRAME_MAX_FRAMES);
+  struct senframe res;
+  for (unsigned i = 0; i < frames; i++) {
+    res.arenas[i] = senarena_new_with_config(config);
+  }
+  res.frames = frames;
+  res.current = 0;
+  return res;
+}
+
+senmac_public
+struct senframe senframe_new(unsigned frames) {
+  assert(frames >= 2 && frames <= SENFRAME_MAX_FRAMES);
+  struct senframe res;
+  for (unsigned i = 0; i < frames; i++) {
+    res.arenas[i] = senarena_new();
+  }
+  res.frames = frames;
+  res.current = 0;
+  return res;
+}
+
+senmac_public
+struct senarena *senframe_arena(struct senframe *restrict frame, unsigned age) {
+  assert(age < frame->frames);
+  return &frame->arenas[(frame->current + frame->frames - age) % frame->frames];
+}
+
+senmac_public
+struct senarena *senframe_advance(struct senframe *restrict frame) {
+  frame->current = frame->current + 1 == frame->frames ? 0 : frame->current + 1;
+  struct senarena *res = &frame->arenas[frame->current];
+  senarena_clear(res);
+  return res;
+}
+
+senmac_public
+void senframe_free(struct senframe frame) {
+  for (unsigned i = 0; i < frame.frames; i++) {
+    senarena_free(frame.arenas[i]);
+  }
+}
@@ -0,0 +1,254 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef _WIN32
+// for MAP_ANONYMOUS
+# define _DEFAULT_SOURCE
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sensible-macros.h"
+
+// The fast path is defined in sensible-arena.c
+#ifndef SENARENA_NOINLINE
+# define SENARENA_NOINLINE
+#endif
+#include "../include/sensible-arena.h"
+
+// An image's arena carves its chunks out of one reservation, in order,
+// so the whole image is a single range of bytes, which starts with the
+// image header:
+//
+//   ---------------------------------------------------------
+//   | header | chunk | chunk | ... |     untouched          |
+//   ---------------------------------------------------------
+//   ^                              ^                        ^
+//   base                           base + size              base + capacity
+//
+// Saving writes out base to base + size, and loading maps that back in,
+// wherever it fits. Offsets between two bytes of the image stay the same,
+// so relative pointers between them stay valid. Absolute pointers, like
+// the ones in the chunk headers, don't, but nothing reads those after
+// loading.
+
+#define SENARENA_IMAGE_MAGIC UINT64_C(0x45474d49414e4553) // "SENAIMGE" in little endian
+#define SENARENA_IMAGE_VERSION 1
+#define SENARENA_IMAGE_CHUNK_SIZE (64 * 1024 - sizeof(struct senarena_chunk_header))
+#define SENARENA_IMAGE_CHUNK_ALIGNMENT 16
+
+struct senarena_image_header {
+  // also tells endianness apart
+  uint64_t magic;
+  uint32_t version;
+  uint32_t pointer_size;
+  // bytes in the image, including this header
+  uint64_t size;
+  // bytes reserved, only while building
+  uint64_t capacity;
+  // offset of the root from base, or 0 for none
+  uint64_t root;
+};
+
+static
+size_t senarena_image_round_up(size_t amount, size_t multiple) {
+  return (amount + multiple - 1) / multiple * multiple;
+}
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+static
+void *senarena_image_reserve(size_t size) {
+  return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+
+static
+void senarena_image_release(void *addr, size_t size) {
+  (void) size;
+  VirtualFree(addr, 0, MEM_RELEASE);
+}
+
+// The view keeps the mapping open after the handles are closed
+static
+void *senarena_image_map_file(const char *path, size_t *size) {
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) return NULL;
+  LARGE_INTEGER file_size;
+  void *res = NULL;
+  if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0 && (uint64_t) file_size.QuadPart <= SIZE_MAX) {
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping != NULL) {
+      res = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(mapping);
+    }
+    *size = (size_t) file_size.QuadPart;
+  }
+  CloseHandle(file);
+  return res;
+}
+
+static
+void senarena_image_unmap_file(const void *addr, size_t size) {
+  (void) size;
+  UnmapViewOfFile(addr);
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef MAP_NORESERVE
+# define MAP_NORESERVE 0
+#endif
+
+static
+void *senarena_image_reserve(size_t size) {
+  void *res = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  return res == MAP_FAILED ? NULL : res;
+}
+
+static
+void senarena_image_release(void *addr, size_t size) {
+  munmap(addr, size);
+}
+
+// Read-only and private, so the pages are shared with every other process
+// that maps the same file, through the page cache
+static
+void *senarena_image_map_file(const char *path, size_t *size) {
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) return NULL;
+  struct stat info;
+  void *res = NULL;
+  if (fstat(fd, &info) == 0 && info.st_size > 0 && (uint64_t) info.st_size <= SIZE_MAX) {
+    res = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (res == MAP_FAILED) res = NULL;
+    *size = (size_t) info.st_size;
+  }
+  close(fd);
+  return res;
+}
+
+static
+void senarena_image_unmap_file(const void *addr, size_t size) {
+  munmap((void*) addr, size);
+}
+
+#endif
+
+// Returns NULL once the reservation is full
+static
+void *senarena_image_chunk_alloc(void *context, size_t size) {
+  struct senarena_image_header *header = (struct senarena_image_header*) context;
+  size = senarena_image_round_up(size, SENARENA_IMAGE_CHUNK_ALIGNMENT);
+  if senarena_unlikely(header->capacity - header->size < size) return NULL;
+  void *res = (unsigned char*) header + header->size;
+  header->size += size;
+  return res;
+}
+
+senmac_public
+struct senarena_image senarena_image_new(size_t capacity) {
+  struct senarena_image res;
+  memset(&res, 0, sizeof(res));
+  capacity = senarena_image_round_up(capacity, SENARENA_IMAGE_CHUNK_ALIGNMENT);
+  if (capacity < sizeof(struct senarena_image_header)) return res;
+  struct senarena_image_header *header = (struct senarena_image_header*) senarena_image_reserve(capacity);
+  if (header == NULL) return res;
+  header->magic = SENARENA_IMAGE_MAGIC;
+  header->version = SENARENA_IMAGE_VERSION;
+  header->pointer_size = sizeof(void*);
+  header->size = senarena_image_round_up(sizeof(struct senarena_image_header), SENARENA_IMAGE_CHUNK_ALIGNMENT);
+  header->capacity = capacity;
+  header->root = 0;
+  struct senarena_config config = {
+    .backend = SENARENA_BACKEND_MALLOC,
+    .huge_pages = false,
+    .chunk_size = SENARENA_MIN(SENARENA_IMAGE_CHUNK_SIZE, capacity / 4),
+    .growth_factor = 2,
+    .max_chunk_size = 0,
+    .allocator = {
+      .alloc = senarena_image_chunk_alloc,
+      // chunks go away with the reservation
+      .free = NULL,
+      .context = header,
+    },
+  };
+  res.arena = senarena_new_with_config(config);
+  res.base = header;
+  res.capacity = capacity;
+  return res;
+}
+
+senmac_public
+size_t senarena_image_size(const struct senarena_image *restrict image) {
+  if (image->base == NULL) return 0;
+  return (size_t) ((const struct senarena_image_header*) image->base)->size;
+}
+
+senmac_public
+bool senarena_image_save(const struct senarena_image *restrict image, const void *root, const char *path) {
+  struct senarena_image_header *header = (struct senarena_image_header*) image->base;
+  if (header == NULL) return false;
+  const uintptr_t base = (uintptr_t) header;
+  // roots below base wrap around to huge offsets
+  if (root != NULL && (uintptr_t) root - base >= header->size) return false;
+  header->root = root == NULL ? 0 : (uint64_t) ((uintptr_t) root - base);
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) return false;
+  const size_t size = (size_t) header->size;
+  // capacity only means something while building
+  struct senarena_image_header saved = *header;
+  saved.capacity = 0;
+  bool ok = fwrite(&saved, sizeof(saved), 1, file) == 1;
+  ok = ok && fwrite((const unsigned char*) header + sizeof(saved), 1, size - sizeof(saved), file) == size - sizeof(saved);
+  return fclose(file) == 0 && ok;
+}
+
+senmac_public
+void senarena_image_free(struct senarena_image image) {
+  if (image.base == NULL) return;
+  senarena_free(image.arena);
+  senarena_image_release(image.base, image.capacity);
+}
+
+senmac_public
+struct senarena_loaded_image senarena_image_load(const char *path) {
+  struct senarena_loaded_image res = {
+    .root = NULL,
+    .base = NULL,
+    .size = 0,
+  };
+  size_t size = 0;
+  const void *base = senarena_image_map_file(path, &size);
+  if (base == NULL) return res;
+  const struct senarena_image_header *header = (const struct senarena_image_header*) base;
+  if (size < sizeof(*header)
+    || header->magic != SENARENA_IMAGE_MAGIC
+    || header->version != SENARENA_IMAGE_VERSION
+    || header->pointer_size != sizeof(void*)
+    || header->size != size
+    || header->root >= size) {
+    senarena_image_unmap_file(base, size);
+    return res;
+  }
+  res.root = header->root == 0 ? NULL : (const unsigned char*) base + header->root;
+  res.base = base;
+  res.size = size;
+  return res;
+}
+
+senmac_public
+void senarena_image_unload(struct senarena_loaded_image image) {
+  if (image.base == NULL) return;
+  senarena_image_unmap_file(image.base, image.size);
+}
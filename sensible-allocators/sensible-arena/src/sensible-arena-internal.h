@@ -0,0 +1,62 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef SENSIBLE_ARENA_INTERNAL_H
+#define SENSIBLE_ARENA_INTERNAL_H
+
+// Shared between the sensible-arena compilation units, not installed.
+
+#include <stdbool.h>
+
+#include "../include/sensible-arena.h"
+
+#define SENARENA_CHUNK_HEADER_SIZE sizeof(struct senarena_chunk_header)
+
+#ifdef SENARENA_STATS
+# define SENARENA_STAT(stmt) stmt
+#else
+# define SENARENA_STAT(stmt)
+#endif
+
+#ifndef SENARENA_MMAP_REGION_SIZE
+# define SENARENA_MMAP_REGION_SIZE (64 * 1024 * 1024)
+#endif
+
+// Process-wide chunk pool, see sensible-arena-pool.c
+
+// Returns NULL if the pool is disabled or empty
+struct senarena_chunk_header *senarena_pool_pop(void);
+// Pools a default-sized malloced chunk, or frees it, if no take could be
+// reading it
+void senarena_pool_release(struct senarena_chunk_header *chunk);
+
+// Deferred freeing, see sensible-arena-reclaim.c
+
+// Queues chains of malloced chunks, linked through ptr, to be freed later.
+// The reusable chain only has default-sized chunks. Either can be NULL.
+void senarena_reclaim_push(struct senarena_chunk_header *reusable, struct senarena_chunk_header *leftovers);
+// Takes the most recently queued chain back, or returns NULL
+struct senarena_chunk_header *senarena_reclaim_pop(void);
+
+// mmap backend, see sensible-arena-mmap.c
+
+struct senarena_region {
+  // previously mapped region
+  struct senarena_region *next;
+  // bytes mapped, including this header
+  size_t size;
+  // bytes carved out, including this header
+  size_t used;
+  bool huge_pages;
+};
+
+// Returns NULL if the region couldn't be mapped
+struct senarena_region *senarena_region_new(size_t min_size, bool huge_pages, struct senarena_region *next);
+// Maps a new region into *regions if the current one is full.
+// Returns NULL if that fails.
+struct senarena_chunk_header *senarena_region_chunk(struct senarena_region **regions, size_t bytes);
+void senarena_regions_free(struct senarena_region *region);
+void senarena_region_discard(uintptr_t start, uintptr_t end);
+
+#endif
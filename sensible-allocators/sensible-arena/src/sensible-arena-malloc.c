@@ -0,0 +1,337 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+// for RTLD_NEXT and MAP_ANONYMOUS
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "sensible-macros.h"
+#include "sensible-arena.h"
+
+// An LD_PRELOAD library, which replaces malloc, and its aligned variants.
+// Allocations made inside a thread's arena scope (senarena_scope_begin /
+// senarena_scope_end) come from that thread's arena, and freeing them does
+// nothing. Everything else goes to glibc's malloc.
+//
+// Thread-local arenas get their chunks from one big reservation, so any
+// thread can tell arena memory apart by its address. Each arena allocation
+// starts with a header holding its size, for realloc, right in front of
+// it, even when it's aligned beyond the header.
+//
+//   reservation
+//   -------------------------------------------------
+//   | chunk | chunk | ... | chunk | untouched       |
+//   -------------------------------------------------
+//   ^                             ^                 ^
+//   start                         top               end
+//
+// Chunks are only released when a thread's arena is freed, which puts
+// them on a free list, to be reused by other threads, first fit.
+
+#ifndef SENARENA_MALLOC_RESERVATION
+# if UINTPTR_MAX > UINT32_MAX
+#  define SENARENA_MALLOC_RESERVATION ((size_t) 64 * 1024 * 1024 * 1024)
+# else
+#  define SENARENA_MALLOC_RESERVATION ((size_t) 256 * 1024 * 1024)
+# endif
+#endif
+
+// Chunks are allocated under a lock, so they're bigger than usual
+#define SENARENA_MALLOC_CHUNK_SIZE (64 * 1024 - sizeof(struct senarena_chunk_header))
+#define SENARENA_MALLOC_CHUNK_ALIGNMENT 64
+
+// Like glibc's malloc
+#define SENARENA_MALLOC_ALIGNMENT 16
+
+void *__libc_malloc(size_t size);
+void __libc_free(void *ptr);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+
+struct senarena_malloc_header {
+  size_t size;
+  size_t padding;
+};
+
+struct senarena_malloc_free_chunk {
+  struct senarena_malloc_free_chunk *next;
+  size_t size;
+};
+
+// All zero until the reservation is made, so that nothing is owned
+static uintptr_t senarena_malloc_start;
+static uintptr_t senarena_malloc_end;
+static uintptr_t senarena_malloc_top;
+static struct senarena_malloc_free_chunk *senarena_malloc_free_chunks;
+static pthread_mutex_t senarena_malloc_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t (*senarena_malloc_libc_usable_size)(void *ptr);
+
+static
+size_t senarena_malloc_round_up(size_t size, size_t alignment) {
+  return (size + alignment - 1) & ~(alignment - 1);
+}
+
+static
+bool senarena_malloc_owns(const void *ptr) {
+  return (uintptr_t) ptr - senarena_malloc_start < senarena_malloc_end - senarena_malloc_start;
+}
+
+// Reuses the first freed chunk that's big enough, splitting off what's
+// left of it, or carves a new one out of the reservation. Returns NULL once
+// the reservation is full.
+static
+void *senarena_malloc_chunk_alloc(void *context, size_t size) {
+  (void) context;
+  size = senarena_malloc_round_up(size, SENARENA_MALLOC_CHUNK_ALIGNMENT);
+  void *res = NULL;
+  pthread_mutex_lock(&senarena_malloc_lock);
+  for (struct senarena_malloc_free_chunk **link = &senarena_malloc_free_chunks; *link != NULL; link = &(*link)->next) {
+    struct senarena_malloc_free_chunk *chunk = *link;
+    if (chunk->size >= size) {
+      res = chunk;
+      if (chunk->size == size) {
+        *link = chunk->next;
+      } else {
+        // both are multiples of the alignment, so the rest is big enough
+        // for its own free list entry
+        struct senarena_malloc_free_chunk *rest = (struct senarena_malloc_free_chunk*) ((uintptr_t) chunk + size);
+        rest->next = chunk->next;
+        rest->size = chunk->size - size;
+        *link = rest;
+      }
+      break;
+    }
+  }
+  if (res == NULL && senarena_malloc_end - senarena_malloc_top >= size) {
+    res = (void*) senarena_malloc_top;
+    senarena_malloc_top += size;
+  }
+  pthread_mutex_unlock(&senarena_malloc_lock);
+  return res;
+}
+
+static
+void senarena_malloc_chunk_free(void *context, void *ptr, size_t size) {
+  (void) context;
+  size = senarena_malloc_round_up(size, SENARENA_MALLOC_CHUNK_ALIGNMENT);
+  // large chunks are rarely reused, so their pages go back to the system
+  if (size > SENARENA_MALLOC_CHUNK_SIZE + sizeof(struct senarena_chunk_header)) {
+    const size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    const uintptr_t start = senarena_malloc_round_up((uintptr_t) ptr + sizeof(struct senarena_malloc_free_chunk), page_size);
+    const uintptr_t end = ((uintptr_t) ptr + size) & ~((uintptr_t) page_size - 1);
+    if (end > start) {
+      madvise((void*) start, end - start, MADV_DONTNEED);
+    }
+  }
+  struct senarena_malloc_free_chunk *chunk = (struct senarena_malloc_free_chunk*) ptr;
+  chunk->size = size;
+  pthread_mutex_lock(&senarena_malloc_lock);
+  chunk->next = senarena_malloc_free_chunks;
+  senarena_malloc_free_chunks = chunk;
+  pthread_mutex_unlock(&senarena_malloc_lock);
+}
+
+__attribute__((constructor))
+static
+void senarena_malloc_init(void) {
+  // ISO C can't cast object pointers to function pointers
+  void *usable_size = dlsym(RTLD_NEXT, "malloc_usable_size");
+  memcpy(&senarena_malloc_libc_usable_size, &usable_size, sizeof(usable_size));
+  void *start = mmap(NULL, SENARENA_MALLOC_RESERVATION, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  // without a reservation, everything goes to glibc
+  if (start == MAP_FAILED) return;
+  struct senarena_config config = {
+    .backend = SENARENA_BACKEND_MALLOC,
+    .huge_pages = false,
+    .chunk_size = SENARENA_MALLOC_CHUNK_SIZE,
+    .growth_factor = 1,
+    .max_chunk_size = SENARENA_MALLOC_CHUNK_SIZE,
+    .allocator = {
+      .alloc = senarena_malloc_chunk_alloc,
+      .free = senarena_malloc_chunk_free,
+      .context = NULL,
+    },
+  };
+  senarena_thread_local_set_config(config);
+  senarena_malloc_top = (uintptr_t) start;
+  senarena_malloc_end = (uintptr_t) start + SENARENA_MALLOC_RESERVATION;
+  senarena_malloc_start = (uintptr_t) start;
+}
+
+// The arena to allocate from, or NULL to use glibc
+static
+struct senarena *senarena_malloc_arena(void) {
+  if senarena_unlikely(senarena_malloc_start == 0) return NULL;
+  return senarena_scope_arena();
+}
+
+// Returns NULL if the arena's run out of chunks
+static
+void *senarena_malloc_alloc(struct senarena *restrict arena, size_t size, bool zero) {
+  if senarena_unlikely(size > SIZE_MAX - sizeof(struct senarena_malloc_header)) return NULL;
+  const size_t amount = size + sizeof(struct senarena_malloc_header);
+  struct senarena_malloc_header *header = (struct senarena_malloc_header*) (zero
+    ? senarena_alloc_zeroed(arena, amount, SENARENA_MALLOC_ALIGNMENT)
+    : senarena_alloc(arena, amount, SENARENA_MALLOC_ALIGNMENT));
+  if senarena_unlikely(header == NULL) return NULL;
+  header->size = size;
+  return header + 1;
+}
+
+// Returns NULL if the arena's run out of chunks. The header goes just
+// before the allocation, in the alignment's worth of bytes in front of it.
+static
+void *senarena_malloc_alloc_aligned(struct senarena *restrict arena, size_t size, size_t alignment) {
+  if (alignment <= SENARENA_MALLOC_ALIGNMENT) return senarena_malloc_alloc(arena, size, false);
+  if senarena_unlikely(size > SIZE_MAX - alignment) return NULL;
+  unsigned char *block = (unsigned char*) senarena_alloc(arena, size + alignment, alignment);
+  if senarena_unlikely(block == NULL) return NULL;
+  struct senarena_malloc_header *header = (struct senarena_malloc_header*) (block + alignment) - 1;
+  header->size = size;
+  return header + 1;
+}
+
+// alignment has to be a power of two
+static
+void *senarena_malloc_memalign(size_t alignment, size_t size) {
+  struct senarena *arena = senarena_malloc_arena();
+  if senarena_likely(arena != NULL) {
+    void *res = senarena_malloc_alloc_aligned(arena, size, alignment);
+    if senarena_likely(res != NULL) return res;
+  }
+  return __libc_memalign(alignment, size);
+}
+
+static
+bool senarena_malloc_is_power_of_two(size_t n) {
+  return n != 0 && (n & (n - 1)) == 0;
+}
+
+senmac_public
+void *malloc(size_t size) {
+  struct senarena *arena = senarena_malloc_arena();
+  if senarena_likely(arena != NULL) {
+    void *res = senarena_malloc_alloc(arena, size, false);
+    if senarena_likely(res != NULL) return res;
+  }
+  return __libc_malloc(size);
+}
+
+senmac_public
+void *calloc(size_t count, size_t size) {
+  struct senarena *arena = senarena_malloc_arena();
+  if senarena_likely(arena != NULL) {
+    if senarena_unlikely(size != 0 && count > SIZE_MAX / size) {
+      errno = ENOMEM;
+      return NULL;
+    }
+    void *res = senarena_malloc_alloc(arena, count * size, true);
+    if senarena_likely(res != NULL) return res;
+  }
+  return __libc_calloc(count, size);
+}
+
+senmac_public
+void free(void *ptr) {
+  // arena memory is freed along with its scope
+  if (ptr == NULL || senarena_malloc_owns(ptr)) return;
+  __libc_free(ptr);
+}
+
+senmac_public
+void *realloc(void *ptr, size_t size) {
+  if (ptr == NULL) return malloc(size);
+  if senarena_likely(!senarena_malloc_owns(ptr)) return __libc_realloc(ptr, size);
+  struct senarena_malloc_header *header = (struct senarena_malloc_header*) ptr - 1;
+  const size_t old_size = header->size;
+  struct senarena *arena = senarena_malloc_arena();
+  if (arena != NULL && size <= SIZE_MAX - sizeof(struct senarena_malloc_header)) {
+    // grows in place if it was the last allocation
+    struct senarena_malloc_header *res = (struct senarena_malloc_header*) senarena_realloc_last(
+      arena,
+      header,
+      old_size + sizeof(struct senarena_malloc_header),
+      size + sizeof(struct senarena_malloc_header),
+      SENARENA_MALLOC_ALIGNMENT);
+    if senarena_likely(res != NULL) {
+      res->size = size;
+      return res + 1;
+    }
+  }
+  // outside a scope, it moves to glibc
+  void *res = __libc_malloc(size);
+  if (res != NULL) {
+    memcpy(res, ptr, SENARENA_MIN(old_size, size));
+  }
+  return res;
+}
+
+// glibc's reallocarray doesn't call our realloc
+senmac_public
+void *reallocarray(void *ptr, size_t count, size_t size) {
+  if senarena_unlikely(size != 0 && count > SIZE_MAX / size) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  return realloc(ptr, count * size);
+}
+
+// glibc's aligned allocation functions don't call our malloc either
+
+senmac_public
+int posix_memalign(void **memptr, size_t alignment, size_t size) {
+  if (!senarena_malloc_is_power_of_two(alignment) || alignment % sizeof(void*) != 0) return EINVAL;
+  void *res = senarena_malloc_memalign(alignment, size);
+  if (res == NULL) return ENOMEM;
+  *memptr = res;
+  return 0;
+}
+
+senmac_public
+void *aligned_alloc(size_t alignment, size_t size) {
+  if (!senarena_malloc_is_power_of_two(alignment)) {
+    errno = EINVAL;
+    return NULL;
+  }
+  return senarena_malloc_memalign(alignment, size);
+}
+
+senmac_public
+void *memalign(size_t alignment, size_t size) {
+  // glibc rounds those up, so it gets to deal with them
+  if (!senarena_malloc_is_power_of_two(alignment)) return __libc_memalign(alignment, size);
+  return senarena_malloc_memalign(alignment, size);
+}
+
+senmac_public
+void *valloc(size_t size) {
+  return senarena_malloc_memalign((size_t) sysconf(_SC_PAGESIZE), size);
+}
+
+senmac_public
+void *pvalloc(size_t size) {
+  const size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+  if senarena_unlikely(size > SIZE_MAX - page_size) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  return senarena_malloc_memalign(page_size, senarena_malloc_round_up(size == 0 ? 1 : size, page_size));
+}
+
+senmac_public
+size_t malloc_usable_size(void *ptr) {
+  if (ptr == NULL) return 0;
+  if (senarena_malloc_owns(ptr)) return ((struct senarena_malloc_header*) ptr - 1)->size;
+  return senarena_malloc_libc_usable_size == NULL ? 0 : senarena_malloc_libc_usable_size(ptr);
+}
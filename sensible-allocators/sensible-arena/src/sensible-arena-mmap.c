@@ -0,0 +1,166 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef _WIN32
+// for MAP_ANONYMOUS and madvise
+# define _DEFAULT_SOURCE
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "sensible-macros.h"
+
+// The fast path is defined in sensible-arena.c
+#ifndef SENARENA_NOINLINE
+# define SENARENA_NOINLINE
+#endif
+#include "sensible-arena-internal.h"
+
+// The mmap backend reserves large regions of virtual memory, and carves
+// chunks out of them, bottom to top. Pages are only backed once they're
+// touched. Chunks are never returned individually, regions are unmapped
+// when the arena is freed.
+//
+// Each region starts with its header:
+//
+//   -------------------------------------------------------
+//   | region | chunk | chunk | ... |    untouched         |
+//   -------------------------------------------------------
+//   ^                              ^                      ^
+//   region                         region + used          region + size
+
+#define SENARENA_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define SENARENA_CHUNK_ALIGNMENT 16
+
+static
+size_t senarena_round_up(size_t amount, size_t multiple) {
+  return (amount + multiple - 1) / multiple * multiple;
+}
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+static
+size_t senarena_page_size(void) {
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwPageSize;
+}
+
+// Large pages need special privileges on Windows, so huge_pages is ignored
+static
+void *senarena_map(size_t size, bool huge_pages) {
+  (void) huge_pages;
+  return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+
+static
+void senarena_unmap(void *addr, size_t size) {
+  (void) size;
+  VirtualFree(addr, 0, MEM_RELEASE);
+}
+
+static
+void senarena_discard_pages(void *addr, size_t size) {
+  VirtualAlloc(addr, size, MEM_RESET, PAGE_READWRITE);
+}
+
+#else
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef MAP_NORESERVE
+# define MAP_NORESERVE 0
+#endif
+
+static
+size_t senarena_page_size(void) {
+  return (size_t) sysconf(_SC_PAGESIZE);
+}
+
+static
+void senarena_unmap(void *addr, size_t size) {
+  munmap(addr, size);
+}
+
+static
+void *senarena_map(size_t size, bool huge_pages) {
+  // over-reserve, so we can trim to a huge page boundary
+  const size_t reserve = huge_pages ? size + SENARENA_HUGE_PAGE_SIZE : size;
+  void *addr = mmap(NULL, reserve, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (addr == MAP_FAILED) return NULL;
+  if (!huge_pages) return addr;
+
+  const uintptr_t start = (uintptr_t) addr;
+  const uintptr_t aligned = senarena_round_up(start, SENARENA_HUGE_PAGE_SIZE);
+  if (aligned > start) {
+    senarena_unmap(addr, aligned - start);
+  }
+  if (start + reserve > aligned + size) {
+    senarena_unmap((void*) (aligned + size), start + reserve - aligned - size);
+  }
+#ifdef MADV_HUGEPAGE
+  // Only a hint, this fails if transparent huge pages are disabled
+  madvise((void*) aligned, size, MADV_HUGEPAGE);
+#endif
+  return (void*) aligned;
+}
+
+static
+void senarena_discard_pages(void *addr, size_t size) {
+  madvise(addr, size, MADV_DONTNEED);
+}
+
+#endif
+
+struct senarena_region *senarena_region_new(size_t min_size, bool huge_pages, struct senarena_region *next) {
+  const size_t granularity = huge_pages ? SENARENA_HUGE_PAGE_SIZE : senarena_page_size();
+  size_t size = min_size + sizeof(struct senarena_region) + SENARENA_CHUNK_ALIGNMENT;
+  if (size < SENARENA_MMAP_REGION_SIZE) size = SENARENA_MMAP_REGION_SIZE;
+  size = senarena_round_up(size, granularity);
+  struct senarena_region *region = (struct senarena_region*) senarena_map(size, huge_pages);
+  if (region == NULL) return NULL;
+  region->next = next;
+  region->size = size;
+  region->used = senarena_round_up(sizeof(struct senarena_region), SENARENA_CHUNK_ALIGNMENT);
+  region->huge_pages = huge_pages;
+  return region;
+}
+
+struct senarena_chunk_header *senarena_region_chunk(struct senarena_region **regions, size_t bytes) {
+  struct senarena_region *region = *regions;
+  bytes = senarena_round_up(bytes, SENARENA_CHUNK_ALIGNMENT);
+  if senarena_unlikely(region->size - region->used < bytes) {
+    region = senarena_region_new(bytes, region->huge_pages, region);
+    if (region == NULL) return NULL;
+    *regions = region;
+  }
+  struct senarena_chunk_header *res = (struct senarena_chunk_header*) ((uintptr_t) region + region->used);
+  region->used += bytes;
+  return res;
+}
+
+void senarena_regions_free(struct senarena_region *region) {
+  while (region != NULL) {
+    struct senarena_region *next = region->next;
+    senarena_unmap(region, region->size);
+    region = next;
+  }
+}
+
+// Gives the whole pages between start and end back to the system. Their
+// contents are undefined afterwards: MADV_DONTNEED pages read as zero, but
+// MEM_RESET ones keep whatever they held, so chunks keep their `zeroed`.
+void senarena_region_discard(uintptr_t start, uintptr_t end) {
+  const size_t page_size = senarena_page_size();
+  start = senarena_round_up(start, page_size);
+  end = end & ~((uintptr_t) page_size - 1);
+  if (end > start) {
+    senarena_discard_pages((void*) start, end - start);
+  }
+}
@@ -0,0 +1,248 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "sensible-macros.h"
+
+// The fast path is defined in sensible-arena.c
+#ifndef SENARENA_NOINLINE
+# define SENARENA_NOINLINE
+#endif
+#include "sensible-arena-internal.h"
+
+// A process-wide Treiber stack of default-sized chunks.
+//
+// The head is a chunk pointer packed together with a tag, which is bumped
+// on every push and pop, so that a pop which read a stale head (A), while
+// another thread popped A, popped B, and pushed A back, fails its CAS
+// instead of installing B (the ABA problem).
+//
+// On 64-bit platforms, we presume user-space pointers fit in 48 bits,
+// leaving 16 bits of tag. Chunks that don't fit simply aren't pooled.
+//
+// A pop reads the next pointer of the chunk at the head, which another
+// thread may pop first, and hand to an arena that frees it. To keep that
+// read safe, takers count themselves in senarena_pool_takers while they're
+// at it, and chunks that may have been in the pool are only freed when
+// nobody is. Otherwise they're pushed back, even over the capacity, for
+// later. A chunk that left the pool before a take started can't be read
+// by it, since it's not reachable from the head anymore.
+
+#if UINTPTR_MAX > UINT32_MAX
+# define SENARENA_POOL_TAG_SHIFT 48
+#else
+# define SENARENA_POOL_TAG_SHIFT 32
+#endif
+
+#define SENARENA_POOL_PTR_MASK ((UINT64_C(1) << SENARENA_POOL_TAG_SHIFT) - 1)
+
+#ifdef _MSC_VER
+
+#include <windows.h>
+
+static
+uint64_t senarena_atomic_load(volatile uint64_t *ptr) {
+  return (uint64_t) InterlockedCompareExchange64((volatile LONG64*) ptr, 0, 0);
+}
+
+// Updates *expected on failure
+static
+bool senarena_atomic_cas(volatile uint64_t *ptr, uint64_t *expected, uint64_t desired) {
+  const uint64_t prev = (uint64_t) InterlockedCompareExchange64((volatile LONG64*) ptr, (LONG64) desired, (LONG64) *expected);
+  const bool res = prev == *expected;
+  *expected = prev;
+  return res;
+}
+
+static
+void senarena_atomic_store(volatile uint64_t *ptr, uint64_t value) {
+  InterlockedExchange64((volatile LONG64*) ptr, (LONG64) value);
+}
+
+// Returns the previous value
+static
+uint64_t senarena_atomic_add(volatile uint64_t *ptr, int64_t amount) {
+  return (uint64_t) InterlockedExchangeAdd64((volatile LONG64*) ptr, amount);
+}
+
+static
+struct senarena_chunk_header *senarena_atomic_load_ptr(struct senarena_chunk_header *volatile *ptr) {
+  return (struct senarena_chunk_header*) InterlockedCompareExchangePointer((void *volatile *) ptr, NULL, NULL);
+}
+
+// Returns the previous value, a full barrier
+static
+uint64_t senarena_atomic_add_seq_cst(volatile uint64_t *ptr, int64_t amount) {
+  return (uint64_t) InterlockedExchangeAdd64((volatile LONG64*) ptr, amount);
+}
+
+// A full barrier before the load
+static
+uint64_t senarena_atomic_load_seq_cst(volatile uint64_t *ptr) {
+  return (uint64_t) InterlockedCompareExchange64((volatile LONG64*) ptr, 0, 0);
+}
+
+#else
+
+static
+uint64_t senarena_atomic_load(volatile uint64_t *ptr) {
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+// Updates *expected on failure
+static
+bool senarena_atomic_cas(volatile uint64_t *ptr, uint64_t *expected, uint64_t desired) {
+  return __atomic_compare_exchange_n(ptr, expected, desired, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static
+void senarena_atomic_store(volatile uint64_t *ptr, uint64_t value) {
+  __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+// Returns the previous value
+static
+uint64_t senarena_atomic_add(volatile uint64_t *ptr, int64_t amount) {
+  return __atomic_fetch_add(ptr, (uint64_t) amount, __ATOMIC_RELAXED);
+}
+
+static
+struct senarena_chunk_header *senarena_atomic_load_ptr(struct senarena_chunk_header *volatile *ptr) {
+  return __atomic_load_n(ptr, __ATOMIC_RELAXED);
+}
+
+// Returns the previous value, a full barrier
+static
+uint64_t senarena_atomic_add_seq_cst(volatile uint64_t *ptr, int64_t amount) {
+  return __atomic_fetch_add(ptr, (uint64_t) amount, __ATOMIC_SEQ_CST);
+}
+
+// A full barrier before the load
+static
+uint64_t senarena_atomic_load_seq_cst(volatile uint64_t *ptr) {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+#endif
+
+static volatile uint64_t senarena_pool_head = 0;
+static volatile uint64_t senarena_pool_capacity = 0;
+static volatile uint64_t senarena_pool_retained = 0;
+static volatile uint64_t senarena_pool_hits = 0;
+static volatile uint64_t senarena_pool_misses = 0;
+// threads in senarena_pool_take
+static volatile uint64_t senarena_pool_takers = 0;
+
+#define SENARENA_POOL_CHUNK_BYTES (SENARENA_DEFAULT_CHUNK_SIZE + SENARENA_CHUNK_HEADER_SIZE)
+
+static
+struct senarena_chunk_header *senarena_pool_unpack(uint64_t head) {
+  return (struct senarena_chunk_header*) (uintptr_t) (head & SENARENA_POOL_PTR_MASK);
+}
+
+static
+uint64_t senarena_pool_pack(struct senarena_chunk_header *chunk, uint64_t previous_head) {
+  const uint64_t tag = (previous_head >> SENARENA_POOL_TAG_SHIFT) + 1;
+  return (uint64_t) (uintptr_t) chunk | (tag << SENARENA_POOL_TAG_SHIFT);
+}
+
+static
+void senarena_pool_link(struct senarena_chunk_header *chunk) {
+  uint64_t head = senarena_atomic_load(&senarena_pool_head);
+  do {
+    chunk->ptr = senarena_pool_unpack(head);
+  } while (!senarena_atomic_cas(&senarena_pool_head, &head, senarena_pool_pack(chunk, head)));
+}
+
+// Returns false if the pool is disabled or full
+static
+bool senarena_pool_push(struct senarena_chunk_header *chunk) {
+  const uint64_t capacity = senarena_atomic_load(&senarena_pool_capacity);
+  if senarena_likely(capacity == 0) return false;
+  if senarena_unlikely(((uint64_t) (uintptr_t) chunk & ~SENARENA_POOL_PTR_MASK) != 0) return false;
+
+  // reserve our bytes before publishing the chunk
+  const uint64_t retained = senarena_atomic_add(&senarena_pool_retained, SENARENA_POOL_CHUNK_BYTES);
+  if (retained + SENARENA_POOL_CHUNK_BYTES > capacity) {
+    senarena_atomic_add(&senarena_pool_retained, -(int64_t) SENARENA_POOL_CHUNK_BYTES);
+    return false;
+  }
+  senarena_pool_link(chunk);
+  return true;
+}
+
+// Frees the chunk, unless a take is under way, which might be reading it,
+// in which case it goes (back) into the pool. Returns whether it was freed.
+static
+bool senarena_pool_free(struct senarena_chunk_header *chunk) {
+  if senarena_likely(senarena_atomic_load_seq_cst(&senarena_pool_takers) == 0) {
+    free(chunk);
+    return true;
+  }
+  senarena_atomic_add(&senarena_pool_retained, SENARENA_POOL_CHUNK_BYTES);
+  senarena_pool_link(chunk);
+  return false;
+}
+
+void senarena_pool_release(struct senarena_chunk_header *chunk) {
+  if senarena_unlikely(((uint64_t) (uintptr_t) chunk & ~SENARENA_POOL_PTR_MASK) != 0) {
+    // it's never been in the pool
+    free(chunk);
+  } else if (!senarena_pool_push(chunk)) {
+    senarena_pool_free(chunk);
+  }
+}
+
+// Returns NULL if the pool is empty
+static
+struct senarena_chunk_header *senarena_pool_take(void) {
+  senarena_atomic_add_seq_cst(&senarena_pool_takers, 1);
+  uint64_t head = senarena_atomic_load(&senarena_pool_head);
+  struct senarena_chunk_header *chunk;
+  do {
+    chunk = senarena_pool_unpack(head);
+    if (chunk == NULL) break;
+  } while (!senarena_atomic_cas(&senarena_pool_head, &head, senarena_pool_pack(senarena_atomic_load_ptr(&chunk->ptr), head)));
+  senarena_atomic_add_seq_cst(&senarena_pool_takers, -1);
+  if (chunk != NULL) {
+    senarena_atomic_add(&senarena_pool_retained, -(int64_t) SENARENA_POOL_CHUNK_BYTES);
+  }
+  return chunk;
+}
+
+struct senarena_chunk_header *senarena_pool_pop(void) {
+  if senarena_likely(senarena_atomic_load(&senarena_pool_capacity) == 0) return NULL;
+  struct senarena_chunk_header *chunk = senarena_pool_take();
+  if (chunk == NULL) {
+    senarena_atomic_add(&senarena_pool_misses, 1);
+    return NULL;
+  }
+  senarena_atomic_add(&senarena_pool_hits, 1);
+  return chunk;
+}
+
+senmac_public
+void senarena_pool_set_capacity(size_t max_retained_bytes) {
+  senarena_atomic_store(&senarena_pool_capacity, max_retained_bytes);
+  // release anything over the new cap, until another thread is taking
+  // chunks too, and the rest has to wait for the next call
+  while (senarena_atomic_load(&senarena_pool_retained) > max_retained_bytes) {
+    struct senarena_chunk_header *chunk = senarena_pool_take();
+    if (chunk == NULL || !senarena_pool_free(chunk)) break;
+  }
+}
+
+senmac_public
+struct senarena_pool_stats senarena_pool_stats(void) {
+  struct senarena_pool_stats res = {
+    .retained_bytes = senarena_atomic_load(&senarena_pool_retained),
+    .hits = senarena_atomic_load(&senarena_pool_hits),
+    .misses = senarena_atomic_load(&senarena_pool_misses),
+  };
+  return res;
+}
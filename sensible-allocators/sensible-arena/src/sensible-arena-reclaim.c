@@ -0,0 +1,304 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "sensible-macros.h"
+
+// The fast path is defined in sensible-arena.c
+#ifndef SENARENA_NOINLINE
+# define SENARENA_NOINLINE
+#endif
+#include "sensible-arena-internal.h"
+
+// Chains handed over by senarena_free_deferred are queued under a lock,
+// linked through the newest chunk's `newer`, which means nothing once the
+// arena is gone:
+//
+//   queue -> chain -newer-> chain -newer-> NULL
+//              |ptr            |ptr
+//              v               v
+//            chunk           chunk
+//              |ptr            |ptr
+//             ...             ...
+//
+// Each arena hands over two chains: its default-sized chunks, which go on
+// the queue, and the rest (like dedicated chunks), which go on the
+// leftovers, so that they don't pile up in chains that keep being reused.
+//
+// senarena_new takes the most recently queued chain, whose chunks are
+// likely still in cache, so as long as arenas come and go at the same
+// rate, nothing is freed or malloced at all. Draining takes both lists at
+// once, and frees them outside the lock. The reclaimer thread sleeps until
+// enough is handed over, so a steady stream of arenas never has to wake it.
+
+// Waking the reclaimer is a system call, so it's only woken once this many
+// chains are queued
+#ifndef SENARENA_RECLAIM_BATCH
+# define SENARENA_RECLAIM_BATCH 32
+#endif
+
+static struct senarena_chunk_header *senarena_reclaim_queue = NULL;
+static struct senarena_chunk_header *senarena_reclaim_leftovers = NULL;
+// chains handed over since the last drain, that haven't been reused
+static unsigned senarena_reclaim_queued = 0;
+static bool senarena_reclaimer_running = false;
+static bool senarena_reclaimer_waiting = false;
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+static SRWLOCK senarena_reclaim_lock = SRWLOCK_INIT;
+static CONDITION_VARIABLE senarena_reclaim_cond = CONDITION_VARIABLE_INIT;
+static HANDLE senarena_reclaimer_thread;
+
+static
+void senarena_reclaim_lock_acquire(void) {
+  AcquireSRWLockExclusive(&senarena_reclaim_lock);
+}
+
+static
+void senarena_reclaim_lock_release(void) {
+  ReleaseSRWLockExclusive(&senarena_reclaim_lock);
+}
+
+static
+void senarena_reclaim_wait(void) {
+  SleepConditionVariableSRW(&senarena_reclaim_cond, &senarena_reclaim_lock, INFINITE, 0);
+}
+
+static
+void senarena_reclaim_wake(void) {
+  WakeConditionVariable(&senarena_reclaim_cond);
+}
+
+static
+void senarena_reclaimer_loop(void);
+
+static
+DWORD WINAPI senarena_reclaimer_main(LPVOID data) {
+  (void) data;
+  senarena_reclaimer_loop();
+  return 0;
+}
+
+static
+bool senarena_reclaimer_spawn(void) {
+  senarena_reclaimer_thread = CreateThread(NULL, 0, senarena_reclaimer_main, NULL, 0, NULL);
+  return senarena_reclaimer_thread != NULL;
+}
+
+static
+void senarena_reclaimer_join(void) {
+  WaitForSingleObject(senarena_reclaimer_thread, INFINITE);
+  CloseHandle(senarena_reclaimer_thread);
+}
+
+#else
+
+#include <pthread.h>
+
+static pthread_mutex_t senarena_reclaim_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t senarena_reclaim_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t senarena_reclaimer_thread;
+
+static
+void senarena_reclaim_lock_acquire(void) {
+  pthread_mutex_lock(&senarena_reclaim_lock);
+}
+
+static
+void senarena_reclaim_lock_release(void) {
+  pthread_mutex_unlock(&senarena_reclaim_lock);
+}
+
+static
+void senarena_reclaim_wait(void) {
+  pthread_cond_wait(&senarena_reclaim_cond, &senarena_reclaim_lock);
+}
+
+static
+void senarena_reclaim_wake(void) {
+  pthread_cond_signal(&senarena_reclaim_cond);
+}
+
+static
+void senarena_reclaimer_loop(void);
+
+static
+void *senarena_reclaimer_main(void *data) {
+  (void) data;
+  senarena_reclaimer_loop();
+  return NULL;
+}
+
+static
+bool senarena_reclaimer_spawn(void) {
+  return pthread_create(&senarena_reclaimer_thread, NULL, senarena_reclaimer_main, NULL) == 0;
+}
+
+static
+void senarena_reclaimer_join(void) {
+  pthread_join(senarena_reclaimer_thread, NULL);
+}
+
+#endif
+
+// The queue is only changed under the lock, but senarena_new peeks at it
+// without taking the lock, to skip it when it's empty
+#if defined(__GNUC__) || defined(__clang__)
+
+static
+struct senarena_chunk_header *senarena_reclaim_peek(void) {
+  return __atomic_load_n(&senarena_reclaim_queue, __ATOMIC_RELAXED);
+}
+
+static
+void senarena_reclaim_set_queue(struct senarena_chunk_header *chain) {
+  __atomic_store_n(&senarena_reclaim_queue, chain, __ATOMIC_RELAXED);
+}
+
+#else
+
+static
+struct senarena_chunk_header *senarena_reclaim_peek(void) {
+  return *(struct senarena_chunk_header *volatile *) &senarena_reclaim_queue;
+}
+
+static
+void senarena_reclaim_set_queue(struct senarena_chunk_header *chain) {
+  *(struct senarena_chunk_header *volatile *) &senarena_reclaim_queue = chain;
+}
+
+#endif
+
+void senarena_reclaim_push(struct senarena_chunk_header *reusable, struct senarena_chunk_header *leftovers) {
+  senarena_reclaim_lock_acquire();
+  if (reusable != NULL) {
+    reusable->newer = senarena_reclaim_queue;
+    senarena_reclaim_set_queue(reusable);
+  }
+  if (leftovers != NULL) {
+    leftovers->newer = senarena_reclaim_leftovers;
+    senarena_reclaim_leftovers = leftovers;
+  }
+  senarena_reclaim_queued++;
+  const bool wake = senarena_reclaimer_waiting && senarena_reclaim_queued >= SENARENA_RECLAIM_BATCH;
+  if (wake) {
+    senarena_reclaimer_waiting = false;
+  }
+  senarena_reclaim_lock_release();
+  if (wake) {
+    senarena_reclaim_wake();
+  }
+}
+
+struct senarena_chunk_header *senarena_reclaim_pop(void) {
+  if senarena_likely(senarena_reclaim_peek() == NULL) return NULL;
+  senarena_reclaim_lock_acquire();
+  struct senarena_chunk_header *res = senarena_reclaim_queue;
+  if (res != NULL) {
+    senarena_reclaim_set_queue(res->newer);
+    senarena_reclaim_queued--;
+  }
+  senarena_reclaim_lock_release();
+  return res;
+}
+
+// Frees the chains, like senarena_free would have, and returns how many
+// chunks they had
+static
+size_t senarena_reclaim_chains(struct senarena_chunk_header *chain) {
+  size_t res = 0;
+  while (chain != NULL) {
+    struct senarena_chunk_header *next_chain = chain->newer;
+    for (struct senarena_chunk_header *chunk = chain; chunk != NULL;) {
+      struct senarena_chunk_header *previous = chunk->ptr;
+      if (chunk->capacity == SENARENA_DEFAULT_CHUNK_SIZE) {
+        senarena_pool_release(chunk);
+      } else {
+        free(chunk);
+      }
+      res++;
+      chunk = previous;
+    }
+    chain = next_chain;
+  }
+  return res;
+}
+
+// Empties both lists, with the lock held
+static
+void senarena_reclaim_take(struct senarena_chunk_header **queue, struct senarena_chunk_header **leftovers) {
+  *queue = senarena_reclaim_queue;
+  *leftovers = senarena_reclaim_leftovers;
+  senarena_reclaim_set_queue(NULL);
+  senarena_reclaim_leftovers = NULL;
+  senarena_reclaim_queued = 0;
+}
+
+static
+void senarena_reclaimer_loop(void) {
+  senarena_reclaim_lock_acquire();
+  for (;;) {
+    // drains everything before stopping
+    const bool stopping = !senarena_reclaimer_running;
+    struct senarena_chunk_header *queue = NULL;
+    struct senarena_chunk_header *leftovers = NULL;
+    if (stopping || senarena_reclaim_queued >= SENARENA_RECLAIM_BATCH) {
+      senarena_reclaim_take(&queue, &leftovers);
+    }
+    if (queue == NULL && leftovers == NULL) {
+      if (stopping) break;
+      senarena_reclaimer_waiting = true;
+      senarena_reclaim_wait();
+      continue;
+    }
+    senarena_reclaim_lock_release();
+    senarena_reclaim_chains(queue);
+    senarena_reclaim_chains(leftovers);
+    senarena_reclaim_lock_acquire();
+  }
+  senarena_reclaimer_waiting = false;
+  senarena_reclaim_lock_release();
+}
+
+senmac_public
+size_t senarena_reclaim(void) {
+  struct senarena_chunk_header *queue;
+  struct senarena_chunk_header *leftovers;
+  senarena_reclaim_lock_acquire();
+  senarena_reclaim_take(&queue, &leftovers);
+  senarena_reclaim_lock_release();
+  return senarena_reclaim_chains(queue) + senarena_reclaim_chains(leftovers);
+}
+
+senmac_public
+bool senarena_reclaimer_start(void) {
+  senarena_reclaim_lock_acquire();
+  const bool was_running = senarena_reclaimer_running;
+  senarena_reclaimer_running = true;
+  senarena_reclaim_lock_release();
+  if (was_running) return true;
+  if (senarena_reclaimer_spawn()) return true;
+  senarena_reclaim_lock_acquire();
+  senarena_reclaimer_running = false;
+  senarena_reclaim_lock_release();
+  return false;
+}
+
+senmac_public
+void senarena_reclaimer_stop(void) {
+  senarena_reclaim_lock_acquire();
+  const bool was_running = senarena_reclaimer_running;
+  senarena_reclaimer_running = false;
+  senarena_reclaimer_waiting = false;
+  senarena_reclaim_lock_release();
+  if (!was_running) return;
+  senarena_reclaim_wake();
+  senarena_reclaimer_join();
+}
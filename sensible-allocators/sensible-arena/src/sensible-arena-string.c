@@ -0,0 +1,198 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sensible-macros.h"
+
+// The fast path is defined in sensible-arena.c
+#ifndef SENARENA_NOINLINE
+# define SENARENA_NOINLINE
+#endif
+#include "../include/sensible-arena.h"
+
+// String builders are senarena_bufs, so they grow in place at the top of
+// the arena, and printf formats straight into their spare capacity, only
+// formatting twice when that's too small.
+//
+// Interned strings are copied into the arena once, and found again through
+// a hash table, which is allocated from the arena as well. Growing the
+// table leaves the old one behind, but the old tables add up to less than
+// the current one.
+
+// Enough for most formatted strings to fit on the first try
+#define SENARENA_STR_MIN_ROOM 64
+
+// Like senarena_buf_reserve, but leaves the length alone
+static
+bool senarena_str_room(struct senarena_buf *restrict buf, size_t amount) {
+  if senarena_likely(buf->capacity - buf->length >= amount) return true;
+  if senarena_unlikely(senarena_buf_reserve(buf, amount) == NULL) return false;
+  buf->length -= amount;
+  return true;
+}
+
+senmac_public
+struct senarena_buf senarena_str_new(struct senarena *restrict arena) {
+  return senarena_buf_new(arena, 1);
+}
+
+senmac_public
+bool senarena_str_append(struct senarena_buf *restrict buf, const char *restrict str) {
+  return senarena_buf_append(buf, str, strlen(str));
+}
+
+senmac_public
+bool senarena_str_vprintf(struct senarena_buf *restrict buf, const char *restrict fmt, va_list args) {
+  if senarena_unlikely(!senarena_str_room(buf, SENARENA_STR_MIN_ROOM)) return false;
+  const size_t room = buf->capacity - buf->length;
+  va_list args1;
+  va_copy(args1, args);
+  const int written = vsnprintf((char*) buf->data + buf->length, room, fmt, args1);
+  va_end(args1);
+  if senarena_unlikely(written < 0) return false;
+  const size_t length = (size_t) written;
+  // vsnprintf needs room for a NUL, which we don't count
+  if senarena_unlikely(length >= room) {
+    if (!senarena_str_room(buf, length + 1)) return false;
+    vsnprintf((char*) buf->data + buf->length, length + 1, fmt, args);
+  }
+  buf->length += length;
+  return true;
+}
+
+senmac_public
+bool senarena_str_printf(struct senarena_buf *restrict buf, const char *restrict fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  const bool res = senarena_str_vprintf(buf, fmt, args);
+  va_end(args);
+  return res;
+}
+
+senmac_public
+char *senarena_str_finish(struct senarena_buf *restrict buf) {
+  if senarena_unlikely(!senarena_buf_append(buf, "", 1)) return NULL;
+  char *res = (char*) senarena_buf_finish(buf);
+  buf->length--;
+  return res;
+}
+
+senmac_public
+char *senarena_sprintf(struct senarena *restrict arena, const char *restrict fmt, ...) {
+  struct senarena_buf buf = senarena_str_new(arena);
+  va_list args;
+  va_start(args, fmt);
+  const bool ok = senarena_str_vprintf(&buf, fmt, args);
+  va_end(args);
+  if senarena_unlikely(!ok) return NULL;
+  return senarena_str_finish(&buf);
+}
+
+// FNV-1a
+static
+size_t senarena_str_hash(const char *str, size_t length) {
+  uint64_t res = UINT64_C(14695981039346656037);
+  for (size_t i = 0; i < length; i++) {
+    res ^= (unsigned char) str[i];
+    res *= UINT64_C(1099511628211);
+  }
+  return (size_t) res;
+}
+
+// The slot holding str, or the empty slot it would go in
+static
+struct senarena_interned *senarena_intern_find(const struct senarena_interner *restrict interner, const char *str, size_t length, size_t hash) {
+  const size_t mask = interner->capacity - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    struct senarena_interned *slot = &interner->slots[i];
+    if (slot->str == NULL) return slot;
+    if (slot->hash == hash && slot->length == length && memcmp(slot->str, str, length) == 0) return slot;
+  }
+}
+
+// Keeps the table at most three quarters full, so that there's always an
+// empty slot to stop at
+static
+bool senarena_interner_make_room(struct senarena_interner *restrict interner) {
+  if senarena_likely((interner->count + 1) * 4 <= interner->capacity * 3) return true;
+  const size_t capacity = interner->capacity == 0 ? 64 : interner->capacity * 2;
+  struct senarena_interned *slots = senarena_calloc_array_of(interner->arena, struct senarena_interned, capacity);
+  if senarena_unlikely(slots == NULL) return false;
+  const struct senarena_interner old = *interner;
+  interner->slots = slots;
+  interner->capacity = capacity;
+  for (size_t i = 0; i < old.capacity; i++) {
+    const struct senarena_interned *slot = &old.slots[i];
+    if (slot->str != NULL) {
+      *senarena_intern_find(interner, slot->str, slot->length, slot->hash) = *slot;
+    }
+  }
+  return true;
+}
+
+// Looks str up, and returns its slot, which is empty if it's new
+static
+struct senarena_interned *senarena_intern_lookup(const struct senarena_interner *restrict interner, const char *str, size_t length, size_t hash) {
+  if senarena_unlikely(interner->capacity == 0) return NULL;
+  return senarena_intern_find(interner, str, length, hash);
+}
+
+senmac_public
+struct senarena_interner senarena_interner_new(struct senarena *restrict arena) {
+  struct senarena_interner res = {
+    .arena = arena,
+    .slots = NULL,
+    .capacity = 0,
+    .count = 0,
+  };
+  return res;
+}
+
+// Inserts str, which is a new string, owned by the arena
+static
+const char *senarena_intern_insert(struct senarena_interner *restrict interner, const char *str, size_t length, size_t hash) {
+  struct senarena_interned *slot = senarena_intern_find(interner, str, length, hash);
+  slot->str = str;
+  slot->length = length;
+  slot->hash = hash;
+  interner->count++;
+  return str;
+}
+
+senmac_public
+const char *senarena_intern(struct senarena_interner *restrict interner, const char *str, size_t length) {
+  const size_t hash = senarena_str_hash(str, length);
+  const struct senarena_interned *slot = senarena_intern_lookup(interner, str, length, hash);
+  if (slot != NULL && slot->str != NULL) return slot->str;
+  if senarena_unlikely(!senarena_interner_make_room(interner)) return NULL;
+  char *copy = (char*) senarena_alloc(interner->arena, length + 1, 1);
+  if senarena_unlikely(copy == NULL) return NULL;
+  memcpy(copy, str, length);
+  copy[length] = '\0';
+  return senarena_intern_insert(interner, copy, length, hash);
+}
+
+senmac_public
+const char *senarena_intern_str(struct senarena_interner *restrict interner, struct senarena_buf *restrict buf) {
+  const char *str = (const char*) buf->data;
+  const size_t length = buf->length;
+  if senarena_unlikely(str == NULL) return senarena_intern(interner, "", 0);
+  const size_t hash = senarena_str_hash(str, length);
+  const struct senarena_interned *slot = senarena_intern_lookup(interner, str, length, hash);
+  if (slot != NULL && slot->str != NULL) {
+    // shrinking it to nothing gives its space back, if it's at the top
+    senarena_realloc_last(buf->arena, buf->data, buf->capacity, 0, 1);
+    *buf = senarena_buf_new(buf->arena, buf->alignment);
+    return slot->str;
+  }
+  // the builder has to be finished before the table can grow on top of it
+  const char *res = senarena_str_finish(buf);
+  if senarena_unlikely(res == NULL || !senarena_interner_make_room(interner)) return NULL;
+  return senarena_intern_insert(interner, res, length, hash);
+}
@@ -0,0 +1,199 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <assert.h>
+#include <stdbool.h>
+// for perror
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sensible-macros.h"
+
+// The fast path is defined in sensible-arena.c
+#ifndef SENARENA_NOINLINE
+# define SENARENA_NOINLINE
+#endif
+#include "../include/sensible-arena.h"
+
+// Scopes are allocated in the thread's arena, just after their own mark
+struct senarena_scope {
+  struct senarena_mark mark;
+  struct senarena_scope *outer;
+};
+
+// One of these is lazily allocated per thread, and stored in
+// thread-specific storage, which calls our destructor on thread exit.
+struct senarena_thread_state {
+  struct senarena arena;
+  // innermost scope
+  struct senarena_scope *scope;
+};
+
+// The arena of the calling thread, while it's inside a scope, so that
+// checking for one (like sensible-arena-malloc does on every call) is
+// cheaper than a thread-specific storage lookup
+#if !defined(_WIN32) && (defined(__GNUC__) || defined(__clang__))
+# define SENARENA_SCOPE_CACHE
+static __thread struct senarena *senarena_scope_cache;
+#endif
+
+// The config of arenas created by senarena_thread_local, which is the
+// default config, unless it's been set
+static struct senarena_config senarena_thread_config;
+
+static
+void senarena_thread_state_free(void *data) {
+  struct senarena_thread_state *state = (struct senarena_thread_state*) data;
+  if (state == NULL) return;
+  senarena_free(state->arena);
+  free(state);
+}
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+static INIT_ONCE senarena_thread_once = INIT_ONCE_STATIC_INIT;
+static DWORD senarena_thread_key;
+
+// Fiber-local storage is the only thread-local storage on Windows
+// that gives us a destructor.
+static
+void WINAPI senarena_thread_destructor(void *data) {
+  senarena_thread_state_free(data);
+}
+
+static
+BOOL CALLBACK senarena_thread_key_init(PINIT_ONCE once, PVOID param, PVOID *ctx) {
+  (void) once;
+  (void) param;
+  (void) ctx;
+  senarena_thread_key = FlsAlloc(senarena_thread_destructor);
+  return senarena_thread_key != FLS_OUT_OF_INDEXES;
+}
+
+static
+void senarena_thread_key_ensure(void) {
+  if (!InitOnceExecuteOnce(&senarena_thread_once, senarena_thread_key_init, NULL, NULL)) {
+    fputs("Couldn't allocate thread-local arena key\n", stderr);
+    exit(1);
+  }
+}
+
+static
+struct senarena_thread_state *senarena_thread_state_get(void) {
+  senarena_thread_key_ensure();
+  return (struct senarena_thread_state*) FlsGetValue(senarena_thread_key);
+}
+
+static
+void senarena_thread_state_set(struct senarena_thread_state *state) {
+  FlsSetValue(senarena_thread_key, state);
+}
+
+#else
+
+#include <pthread.h>
+
+static pthread_once_t senarena_thread_once = PTHREAD_ONCE_INIT;
+static pthread_key_t senarena_thread_key;
+
+static
+void senarena_thread_key_init(void) {
+  if (pthread_key_create(&senarena_thread_key, senarena_thread_state_free) != 0) {
+    perror("Couldn't allocate thread-local arena key");
+    exit(1);
+  }
+}
+
+static
+struct senarena_thread_state *senarena_thread_state_get(void) {
+  pthread_once(&senarena_thread_once, senarena_thread_key_init);
+  return (struct senarena_thread_state*) pthread_getspecific(senarena_thread_key);
+}
+
+static
+void senarena_thread_state_set(struct senarena_thread_state *state) {
+  pthread_setspecific(senarena_thread_key, state);
+}
+
+#endif
+
+static
+struct senarena_thread_state *senarena_thread_state_ensure(void) {
+  struct senarena_thread_state *state = senarena_thread_state_get();
+  if senarena_unlikely(state == NULL) {
+    state = (struct senarena_thread_state*) malloc(sizeof(struct senarena_thread_state));
+    if (state == NULL) {
+      perror("Couldn't allocate thread-local arena");
+      exit(1);
+    }
+    state->arena = senarena_new_with_config(senarena_thread_config);
+    state->scope = NULL;
+    senarena_thread_state_set(state);
+  }
+  return state;
+}
+
+senmac_public
+struct senarena *senarena_thread_local(void) {
+  return &senarena_thread_state_ensure()->arena;
+}
+
+senmac_public
+void senarena_thread_local_set_config(struct senarena_config config) {
+  senarena_thread_config = config;
+}
+
+senmac_public
+void senarena_thread_local_free(void) {
+  struct senarena_thread_state *state = senarena_thread_state_get();
+#ifdef SENARENA_SCOPE_CACHE
+  senarena_scope_cache = NULL;
+#endif
+  senarena_thread_state_set(NULL);
+  senarena_thread_state_free(state);
+}
+
+senmac_public
+struct senarena *senarena_scope_begin(void) {
+  struct senarena_thread_state *state = senarena_thread_state_ensure();
+  const struct senarena_mark mark = senarena_mark(&state->arena);
+  struct senarena_scope *scope = senarena_alloc_type(&state->arena, struct senarena_scope);
+  // the arena's allocator ran out, so there's no scope to end
+  if senarena_unlikely(scope == NULL) return NULL;
+  scope->mark = mark;
+  scope->outer = state->scope;
+  state->scope = scope;
+#ifdef SENARENA_SCOPE_CACHE
+  senarena_scope_cache = &state->arena;
+#endif
+  return &state->arena;
+}
+
+senmac_public
+void senarena_scope_end(void) {
+  struct senarena_thread_state *state = senarena_thread_state_get();
+  assert(state != NULL && state->scope != NULL);
+  const struct senarena_scope scope = *state->scope;
+  state->scope = scope.outer;
+  if (scope.outer == NULL) {
+#ifdef SENARENA_SCOPE_CACHE
+    senarena_scope_cache = NULL;
+#endif
+    senarena_clear(&state->arena);
+  } else {
+    senarena_rewind(&state->arena, scope.mark);
+  }
+}
+
+senmac_public
+struct senarena *senarena_scope_arena(void) {
+#ifdef SENARENA_SCOPE_CACHE
+  return senarena_scope_cache;
+#else
+  struct senarena_thread_state *state = senarena_thread_state_get();
+  return state != NULL && state->scope != NULL ? &state->arena : NULL;
+#endif
+}
@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "sensible-macros.h"
 
@@ -15,7 +16,7 @@
 #include "../include/sensible-arena.h"
 #undef SENARENA_IMPL
 
-#define SENARENA_CHUNK_HEADER_SIZE sizeof(struct senarena_chunk_header)
+#include "sensible-arena-internal.h"
 
 // This basically acts like a zipper, where `new` chunks are
 // reusable, and `old` chunks are full
@@ -30,6 +31,17 @@
 //
 // When chunk is current:
 // * Pointer refers to previously used chunk (at start f chunk_header)
+//
+// Every chunk knows how much of its bottom is still zero (only pages fresh
+// from mmap start out that way). Allocations move top down, so everything
+// above top has been handed out, and the arena only has to lower its
+// `zeroed` when top moves back up, or when it switches chunks.
+//
+// Used chunks also point back at the chunk that was used after them
+// (`newer`), so that senarena_rewind can find the oldest chunk acquired
+// after a mark, without walking the chain. The arena keeps the `oldest`
+// used chunk, so that clearing splices the used chain onto the fresh
+// chunks without walking it either.
 
 /*
  *   NULL   -------------
@@ -66,128 +78,747 @@
  *
  */
 
-// Returns a pointer to *after* the chunk_header
+// Returns a pointer to *after* the chunk_header, or 0 if the arena's
+// allocator failed
 static
-uintptr_t senarena_chunk_new(uintptr_t size, struct senarena_chunk_header *ptr) {
-  // with size 7 and alignment 8 you'll need 1 more byte if you align up or down
-  struct senarena_chunk_header *chunk = (struct senarena_chunk_header*) malloc(size + SENARENA_CHUNK_HEADER_SIZE);
+uintptr_t senarena_chunk_new(struct senarena *restrict arena, uintptr_t size, struct senarena_chunk_header *ptr) {
+  struct senarena_chunk_header *chunk = NULL;
+  bool zeroed = false;
+  if (arena->allocator.alloc != NULL) {
+    chunk = (struct senarena_chunk_header*) arena->allocator.alloc(arena->allocator.context, size + SENARENA_CHUNK_HEADER_SIZE);
+    if (chunk == NULL) return 0;
+  } else if (arena->regions != NULL) {
+    chunk = senarena_region_chunk(&arena->regions, size + SENARENA_CHUNK_HEADER_SIZE);
+    zeroed = true;
+  } else {
+    if (size == SENARENA_DEFAULT_CHUNK_SIZE) {
+      chunk = senarena_pool_pop();
+    }
+    if (chunk == NULL) {
+      // with size 7 and alignment 8 you'll need 1 more byte if you align up or down
+      chunk = (struct senarena_chunk_header*) malloc(size + SENARENA_CHUNK_HEADER_SIZE);
+    }
+  }
   if (chunk == NULL) {
     perror("Couldn't allocate arena chunk");
     exit(1);
   }
   chunk->ptr = ptr;
   chunk->capacity = size;
-  return (uintptr_t) chunk + SENARENA_CHUNK_HEADER_SIZE;
+  const uintptr_t res = (uintptr_t) chunk + SENARENA_CHUNK_HEADER_SIZE;
+  chunk->zeroed = zeroed ? res + size : res;
+  return res;
 }
 
-senmac_public
-struct senarena senarena_new() {
-  uintptr_t bottom = senarena_chunk_new(SENARENA_DEFAULT_CHUNK_SIZE, NULL);
+// Called before top moves up, over bytes that have been handed out
+static
+void senarena_settle_zeroed(struct senarena *restrict arena) {
+  arena->zeroed = SENARENA_MIN(arena->zeroed, arena->top);
+}
+
+// Makes next the current chunk, saving what's known to be zero in the
+// current one
+static
+void senarena_switch_chunk(struct senarena *restrict arena, struct senarena_chunk_header *current, struct senarena_chunk_header *next) {
+  current->zeroed = SENARENA_MIN(arena->zeroed, arena->top);
+  arena->bottom = (uintptr_t) next + SENARENA_CHUNK_HEADER_SIZE;
+  arena->top = arena->bottom + next->capacity;
+  arena->zeroed = next->zeroed;
+}
+
+// Called after every new (non-dedicated) chunk
+static
+void senarena_grow_chunk_size(struct senarena *restrict arena) {
+  if senarena_likely(arena->growth_factor <= 1 || arena->chunk_size >= arena->max_chunk_size) return;
+  const size_t max_total = arena->max_chunk_size + SENARENA_CHUNK_HEADER_SIZE;
+  const size_t total = arena->chunk_size + SENARENA_CHUNK_HEADER_SIZE;
+  arena->chunk_size = total > max_total / arena->growth_factor
+    ? arena->max_chunk_size
+    : total * arena->growth_factor - SENARENA_CHUNK_HEADER_SIZE;
+}
+
+// Everything but the first chunk
+static
+struct senarena senarena_from_config(struct senarena_config config) {
   struct senarena res = {
-    .top = bottom + SENARENA_DEFAULT_CHUNK_SIZE,
-    .bottom = bottom,
+    .top = 0,
+    .bottom = 0,
+    .zeroed = 0,
     .fresh_chunks = NULL,
+    .oldest = NULL,
+    .buffer = NULL,
+    .cleanups = NULL,
+    .regions = NULL,
+    .allocator = config.allocator,
+    .chunk_size = config.chunk_size == 0 ? SENARENA_DEFAULT_CHUNK_SIZE : config.chunk_size,
+    .max_chunk_size = config.max_chunk_size == 0 ? SENARENA_DEFAULT_MAX_CHUNK_SIZE : config.max_chunk_size,
+    .growth_factor = config.growth_factor == 0 ? 1 : config.growth_factor,
+    .max_alignment = 1,
   };
+  if (res.max_chunk_size < res.chunk_size) {
+    res.max_chunk_size = res.chunk_size;
+  }
+  if (config.allocator.alloc == NULL && config.backend == SENARENA_BACKEND_MMAP) {
+    res.regions = senarena_region_new(0, config.huge_pages, NULL);
+    if (res.regions == NULL) {
+      perror("Couldn't map arena region");
+      exit(1);
+    }
+  }
   return res;
 }
 
-// O(min(n, m)) where n, m are the sizes of the linked chunk lists a and b
+// Gives an arena without a chunk (bottom is 0) its first one. Returns
+// false, leaving it without, if the arena's allocator failed.
 static
-struct senarena_chunk_header *senarena_join_chunk_chains(struct senarena_chunk_header *a, struct senarena_chunk_header *b) {
-  // a is free chunks, b is old chunks
+bool senarena_first_chunk(struct senarena *restrict arena) {
+  const uintptr_t bottom = senarena_chunk_new(arena, arena->chunk_size, NULL);
+  if senarena_unlikely(bottom == 0) return false;
+  arena->bottom = bottom;
+  arena->top = bottom + arena->chunk_size;
+  arena->oldest = (struct senarena_chunk_header*) (bottom - SENARENA_CHUNK_HEADER_SIZE);
+  arena->zeroed = arena->oldest->zeroed;
+  senarena_grow_chunk_size(arena);
+  SENARENA_STAT(arena->stats.chunks = 1);
+  return true;
+}
 
-  if senarena_likely(a == NULL) return b;
-  if senarena_likely(b == NULL) return a;
+senmac_public
+struct senarena senarena_new_with_config(struct senarena_config config) {
+  struct senarena res = senarena_from_config(config);
+  senarena_first_chunk(&res);
+  return res;
+}
 
-  struct senarena_chunk_header *curr_a = a;
-  struct senarena_chunk_header *curr_b = b;
+static const struct senarena_config senarena_default_config = {
+  .backend = SENARENA_BACKEND_MALLOC,
+  .huge_pages = false,
+  .chunk_size = SENARENA_DEFAULT_CHUNK_SIZE,
+  .growth_factor = 1,
+  .max_chunk_size = SENARENA_DEFAULT_CHUNK_SIZE,
+};
 
-  struct senarena_chunk_header *next_a = a->ptr;
-  struct senarena_chunk_header *next_b = b->ptr;
+// Takes over a chain that senarena_free_deferred handed over, with its
+// first chunk as the current one, and the rest as reusable ones
+static
+struct senarena senarena_from_chain(struct senarena_chunk_header *chain) {
+  struct senarena res = senarena_from_config(senarena_default_config);
+  res.fresh_chunks = chain->ptr;
+  chain->ptr = NULL;
+  res.bottom = (uintptr_t) chain + SENARENA_CHUNK_HEADER_SIZE;
+  res.top = res.bottom + chain->capacity;
+  // the previous arena kept track of this for its current chunk
+  res.zeroed = res.bottom;
+  res.oldest = chain;
+#ifdef SENARENA_STATS
+  res.stats.chunks = 1;
+  for (const struct senarena_chunk_header *chunk = res.fresh_chunks; chunk != NULL; chunk = chunk->ptr) {
+    res.stats.chunks++;
+  }
+#endif
+  return res;
+}
+
+senmac_public
+struct senarena senarena_new() {
+  struct senarena_chunk_header *chain = senarena_reclaim_pop();
+  if (chain != NULL) return senarena_from_chain(chain);
+  return senarena_new_with_config(senarena_default_config);
+}
 
-  while (next_a != NULL && next_b != NULL) {
-    curr_a = next_a;
-    curr_b = next_b;
-    next_a = curr_a->ptr;
-    next_b = curr_b->ptr;
+senmac_public
+struct senarena senarena_new_with_buffer(void *buf, size_t len) {
+  const uintptr_t start = (uintptr_t) buf;
+  const uintptr_t alignment = SENARENA_ALIGNOF(struct senarena_chunk_header);
+  const uintptr_t header = SENARENA_ALIGN_DOWN(start + alignment - 1, alignment);
+  // too small to be worth a chunk
+  if (buf == NULL || header + SENARENA_CHUNK_HEADER_SIZE >= start + len) {
+    return senarena_new();
   }
+  struct senarena res = senarena_from_config(senarena_default_config);
+  struct senarena_chunk_header *chunk = (struct senarena_chunk_header*) header;
+  chunk->ptr = NULL;
+  chunk->capacity = start + len - header - SENARENA_CHUNK_HEADER_SIZE;
+  res.bottom = header + SENARENA_CHUNK_HEADER_SIZE;
+  res.top = res.bottom + chunk->capacity;
+  chunk->zeroed = res.bottom;
+  res.zeroed = res.bottom;
+  res.oldest = chunk;
+  res.buffer = chunk;
+  SENARENA_STAT(res.stats.chunks = 1);
+  return res;
+}
 
-  if senarena_likely(next_a == NULL) {
-    curr_a->ptr = b;
-    return a;
-  } else {
-    curr_b->ptr = a;
-    return b;
+// Moves the chain newest -> ... -> oldest onto the front of the fresh chunks
+static
+void senarena_release_chunks(struct senarena *restrict arena, struct senarena_chunk_header *newest, struct senarena_chunk_header *oldest) {
+  oldest->ptr = arena->fresh_chunks;
+  arena->fresh_chunks = newest;
+}
+
+// Runs the cleanups registered after the until batch had until_count of
+// them, newest first
+static
+void senarena_run_cleanups(struct senarena *restrict arena, struct senarena_cleanups *until, unsigned until_count) {
+  struct senarena_cleanups *batch = arena->cleanups;
+  for (; batch != until; batch = batch->next) {
+    for (unsigned i = batch->count; i-- > 0;) {
+      batch->entries[i].fn(batch->entries[i].context);
+    }
+  }
+  if (batch != NULL) {
+    for (unsigned i = batch->count; i-- > until_count;) {
+      batch->entries[i].fn(batch->entries[i].context);
+    }
+    batch->count = until_count;
+  }
+  arena->cleanups = batch;
+}
+
+senmac_public
+bool senarena_on_clear(struct senarena *restrict arena, void (*fn)(void *context), void *context) {
+  struct senarena_cleanups *batch = arena->cleanups;
+  if senarena_unlikely(batch == NULL || batch->count == SENARENA_CLEANUP_BATCH) {
+    batch = senarena_alloc_type(arena, struct senarena_cleanups);
+    if senarena_unlikely(batch == NULL) return false;
+    batch->next = arena->cleanups;
+    batch->count = 0;
+    arena->cleanups = batch;
   }
+  struct senarena_cleanup cleanup = { .fn = fn, .context = context };
+  batch->entries[batch->count++] = cleanup;
+  return true;
 }
 
+// O(1), plus the cleanups
 senmac_public
 void senarena_clear(struct senarena *restrict arena) {
+  if senarena_unlikely(arena->cleanups != NULL) {
+    senarena_run_cleanups(arena, NULL, 0);
+  }
+  // its first chunk failed, so there's nothing to clear
+  if senarena_unlikely(arena->bottom == 0) return;
   struct senarena_chunk_header *current = (struct senarena_chunk_header*) (arena->bottom - SENARENA_CHUNK_HEADER_SIZE);
+  senarena_settle_zeroed(arena);
   arena->top = (uintptr_t) current + current->capacity + SENARENA_CHUNK_HEADER_SIZE;
-  arena->fresh_chunks = senarena_join_chunk_chains(arena->fresh_chunks, current->ptr);
-  current->ptr = NULL;
+  // the next cycle may not need chunks that big
+  arena->max_alignment = 1;
+  if (current->ptr != NULL) {
+    senarena_release_chunks(arena, current->ptr, arena->oldest);
+    current->ptr = NULL;
+    arena->oldest = current;
+  }
+#ifdef SENARENA_STATS
+  arena->stats.peak_live_bytes = SENARENA_MAX(arena->stats.peak_live_bytes, arena->stats.live_bytes);
+  arena->stats.live_bytes = 0;
+  arena->stats.padding_bytes = 0;
+#endif
+}
+
+// Bytes a chunk needs on top of amount, so that an allocation aligned to
+// alignment fits below its top, wherever that ends up. Chunks (and so
+// their bottoms) are at least header-aligned, so the next aligned address
+// is at most this far above the bottom.
+static
+size_t senarena_alignment_slack(size_t alignment) {
+  const size_t chunk_alignment = SENARENA_ALIGNOF(struct senarena_chunk_header);
+  return alignment > chunk_alignment ? alignment - chunk_alignment : 0;
+}
+
+// Chunks that aren't dedicated are made big enough for this many
+// allocations aligned like the most aligned one since the last clear, so
+// that those share chunks, and lose at most about one of the slots to the
+// header
+#ifndef SENARENA_ALIGNED_CHUNK_SLOTS
+# define SENARENA_ALIGNED_CHUNK_SLOTS 16
+#endif
+
+// Capacity of the next new chunk that isn't dedicated, not counting the
+// room to align its top
+static
+size_t senarena_regular_chunk_size(const struct senarena *restrict arena) {
+  const size_t alignment = arena->max_alignment;
+  if senarena_likely(alignment <= arena->chunk_size / SENARENA_ALIGNED_CHUNK_SLOTS) return arena->chunk_size;
+  return alignment * SENARENA_ALIGNED_CHUNK_SLOTS - SENARENA_CHUNK_HEADER_SIZE;
+}
+
+// Allocations that would take up much of a new chunk, once they've been
+// padded, get a chunk of their own. The arena remembers alignments that
+// allocations fill at least half of, since those pack well, to make its
+// next chunks big enough for them, if those chunks, along with the room
+// to align their top, fit in max_chunk_size.
+static
+bool senarena_needs_dedicated(struct senarena *restrict arena, size_t amount, size_t alignment) {
+  if senarena_unlikely(alignment > arena->max_alignment
+    && alignment > SENARENA_ALIGNOF(struct senarena_chunk_header)
+    && amount >= alignment / 2
+    && alignment <= arena->max_chunk_size / (SENARENA_ALIGNED_CHUNK_SLOTS + 1)) {
+    arena->max_alignment = alignment;
+  }
+  return amount + senarena_alignment_slack(alignment) >= senarena_regular_chunk_size(arena) >> 2;
+}
+
+// Unlinks the first reusable chunk with between min and max bytes, if any.
+// O(reusable chunks), though it's usually the first one.
+static
+struct senarena_chunk_header *senarena_take_fresh_chunk(struct senarena *restrict arena, size_t min, size_t max) {
+  for (struct senarena_chunk_header **link = &arena->fresh_chunks; *link != NULL; link = &(*link)->ptr) {
+    if senarena_likely((*link)->capacity >= min && (*link)->capacity <= max) {
+      struct senarena_chunk_header *res = *link;
+      *link = res->ptr;
+      SENARENA_STAT(arena->stats.fresh_chunk_reuses++);
+      return res;
+    }
+  }
+  return NULL;
 }
 
-// this is only called when a chunk is being allocated specifically for one
-// allocation.
+// A chunk of its own, behind the current one, for a large (or very
+// aligned) allocation, with just enough room to align it.
+// Zeroes the allocation if zero is set.
 static
-size_t senarena_extra_fresh_bytes_needed(uintptr_t alignment) {
-  const uintptr_t start = alignment > SENARENA_CHUNK_HEADER_SIZE ? alignment - SENARENA_CHUNK_HEADER_SIZE : SENARENA_CHUNK_HEADER_SIZE;
-  return senarena_extra_bytes_needed(start, alignment);
+uintptr_t senarena_alloc_dedicated(struct senarena *restrict arena, size_t amount, size_t alignment, bool zero) {
+  // Makes it possible to allocate large objects here.
+  // Really, you just shouldn't...
+  struct senarena_chunk_header *current_header = (struct senarena_chunk_header*) (arena->bottom - SENARENA_CHUNK_HEADER_SIZE);
+  const size_t slack = senarena_alignment_slack(alignment);
+  // a reusable chunk will do, if it isn't much bigger than needed
+  const size_t needed = amount + slack;
+  struct senarena_chunk_header *dedicated = senarena_take_fresh_chunk(arena, needed, needed > SIZE_MAX / 2 ? SIZE_MAX : needed * 2);
+  uintptr_t bottom;
+  if (dedicated != NULL) {
+    bottom = (uintptr_t) dedicated + SENARENA_CHUNK_HEADER_SIZE;
+    dedicated->ptr = current_header->ptr;
+  } else {
+    bottom = senarena_chunk_new(arena, needed, current_header->ptr);
+    if senarena_unlikely(bottom == 0) return 0;
+    dedicated = (struct senarena_chunk_header*) (bottom - SENARENA_CHUNK_HEADER_SIZE);
+    SENARENA_STAT(arena->stats.chunks++);
+  }
+  dedicated->newer = current_header;
+  if (current_header->ptr != NULL) {
+    current_header->ptr->newer = dedicated;
+  } else {
+    arena->oldest = dedicated;
+  }
+  current_header->ptr = dedicated;
+  // as high as it goes, like any other allocation
+  const uintptr_t res = SENARENA_ALIGN_DOWN(bottom + slack, alignment);
+  if (zero) {
+    senarena_zero_unknown(res, amount, dedicated->zeroed);
+  }
+  // it's all handed out
+  dedicated->zeroed = bottom;
+#ifdef SENARENA_STATS
+  arena->stats.dedicated_chunks++;
+  arena->stats.live_bytes += amount;
+  arena->stats.padding_bytes += slack;
+#endif
+  return res;
 }
 
 senmac_public
 uintptr_t senarena_alloc_more(struct senarena *restrict arena, size_t amount, size_t alignment) {
+  if senarena_unlikely(arena->bottom == 0 && !senarena_first_chunk(arena)) return 0;
   // true is... quite likely
   while senarena_likely(true) {
     intptr_t amount_and_padding = amount + senarena_extra_bytes_needed((intptr_t) arena->top - amount, alignment);
     const intptr_t free_space = arena->top - arena->bottom;
     // likely because if we reach here, it'll be true *at least* once
     if senarena_likely(amount_and_padding > free_space) {
-      // extra bytes needed on a fresh chunk
       // unlikely, because we want to optimize for smaller allocations
-      if senarena_unlikely(amount >= SENARENA_DEFAULT_CHUNK_SIZE >> 2) {
-        // Makes it possible to allocate large objects here.
-        // Really, you just shouldn't...
-        struct senarena_chunk_header *current_header = (struct senarena_chunk_header*) (arena->bottom - SENARENA_CHUNK_HEADER_SIZE);
-        const size_t extra_fresh_bytes = senarena_extra_fresh_bytes_needed(alignment);
-        uintptr_t res = senarena_chunk_new(amount + extra_fresh_bytes, current_header->ptr);
-        current_header->ptr = (struct senarena_chunk_header*) (res - SENARENA_CHUNK_HEADER_SIZE);
-        return res + extra_fresh_bytes;
+      if senarena_unlikely(senarena_needs_dedicated(arena, amount, alignment)) {
+        return senarena_alloc_dedicated(arena, amount, alignment, false);
       } else {
-        // I don't know if this (unlikely) is a good tradeoff
-        if senarena_unlikely(arena->fresh_chunks != NULL) {
-          struct senarena_chunk_header *next = arena->fresh_chunks;
-          arena->fresh_chunks = next->ptr;
-          next->ptr = (struct senarena_chunk_header*) (arena->bottom - SENARENA_CHUNK_HEADER_SIZE);
-          arena->top = (uintptr_t) next + SENARENA_CHUNK_HEADER_SIZE + next->capacity;
-          arena->bottom = (uintptr_t) next + SENARENA_CHUNK_HEADER_SIZE;
+        // I don't know if this (unlikely) is a good tradeoff.
+        // Reusable chunks that couldn't fit it, once padded, are left for
+        // later, rather than used up.
+        struct senarena_chunk_header *next = senarena_take_fresh_chunk(arena, amount + senarena_alignment_slack(alignment), SIZE_MAX);
+        if senarena_unlikely(next != NULL) {
+          struct senarena_chunk_header *current_header = (struct senarena_chunk_header*) (arena->bottom - SENARENA_CHUNK_HEADER_SIZE);
+          next->ptr = current_header;
+          current_header->newer = next;
+          senarena_switch_chunk(arena, current_header, next);
           continue;
         } else {
           struct senarena_chunk_header *current_header = (struct senarena_chunk_header*) (arena->bottom - SENARENA_CHUNK_HEADER_SIZE);
-          arena->bottom = senarena_chunk_new(SENARENA_DEFAULT_CHUNK_SIZE, current_header);
-          arena->top = arena->bottom + SENARENA_DEFAULT_CHUNK_SIZE;
+          // with room to start the payload at an aligned top
+          const size_t size = senarena_regular_chunk_size(arena) + (arena->max_alignment - 1);
+          const uintptr_t bottom = senarena_chunk_new(arena, size, current_header);
+          if senarena_unlikely(bottom == 0) return 0;
+          next = (struct senarena_chunk_header*) (bottom - SENARENA_CHUNK_HEADER_SIZE);
+          current_header->newer = next;
+          senarena_switch_chunk(arena, current_header, next);
+          arena->top = SENARENA_ALIGN_DOWN(arena->top, arena->max_alignment);
+          senarena_grow_chunk_size(arena);
+          SENARENA_STAT(arena->stats.chunks++);
+          // the padding depends on the new top
+          continue;
         }
       }
     }
     arena->top -= amount_and_padding;
+#ifdef SENARENA_STATS
+    arena->stats.live_bytes += amount;
+    arena->stats.padding_bytes += amount_and_padding - amount;
+#endif
     return arena->top;
   }
 }
 
+senmac_public
+uintptr_t senarena_alloc_zeroed_more(struct senarena *restrict arena, size_t amount, size_t alignment) {
+  if senarena_unlikely(arena->bottom == 0 && !senarena_first_chunk(arena)) return 0;
+  if senarena_unlikely(senarena_needs_dedicated(arena, amount, alignment)) {
+    return senarena_alloc_dedicated(arena, amount, alignment, true);
+  }
+  // this always moves to another chunk, whose zeroed is up to date
+  const uintptr_t res = senarena_alloc_more(arena, amount, alignment);
+  if senarena_unlikely(res == 0) return 0;
+  senarena_zero_unknown(res, amount, arena->zeroed);
+  return res;
+}
+
+// O(reusable chunks), when the current chunk doesn't have room
+senmac_public
+bool senarena_reserve(struct senarena *restrict arena, size_t amount) {
+  // the arena's allocator couldn't supply its first chunk, until now
+  if senarena_unlikely(arena->bottom == 0 && !senarena_first_chunk(arena)) return false;
+  if senarena_likely(arena->top - arena->bottom >= amount) return true;
+  struct senarena_chunk_header *current_header = (struct senarena_chunk_header*) (arena->bottom - SENARENA_CHUNK_HEADER_SIZE);
+  struct senarena_chunk_header *next = senarena_take_fresh_chunk(arena, amount, SIZE_MAX);
+  if (next == NULL) {
+    const size_t size = SENARENA_MAX(amount, arena->chunk_size);
+    const uintptr_t bottom = senarena_chunk_new(arena, size, current_header);
+    if senarena_unlikely(bottom == 0) return false;
+    next = (struct senarena_chunk_header*) (bottom - SENARENA_CHUNK_HEADER_SIZE);
+    if (size == arena->chunk_size) {
+      senarena_grow_chunk_size(arena);
+    }
+    SENARENA_STAT(arena->stats.chunks++);
+  }
+  next->ptr = current_header;
+  current_header->newer = next;
+  senarena_switch_chunk(arena, current_header, next);
+  return true;
+}
+
+// Frees every chunk in the chain, except the one in the caller's buffer,
+// which is returned (on its own) if it was in there
 static
-void senarena_free_chunk_chain(struct senarena_chunk_header *current) {
+struct senarena_chunk_header *senarena_free_chunk_chain(struct senarena *restrict arena, struct senarena_chunk_header *current) {
+  struct senarena_chunk_header *res = NULL;
   while (current) {
     struct senarena_chunk_header *previous = current->ptr;
-    free(current);
+    if senarena_unlikely(current == arena->buffer) {
+      res = current;
+      res->ptr = NULL;
+    } else {
+      if (arena->allocator.alloc != NULL) {
+        arena->allocator.free(arena->allocator.context, current, current->capacity + SENARENA_CHUNK_HEADER_SIZE);
+      } else if (current->capacity == SENARENA_DEFAULT_CHUNK_SIZE) {
+        senarena_pool_release(current);
+      } else {
+        free(current);
+      }
+      SENARENA_STAT(arena->stats.chunks--);
+    }
     current = previous;
   }
+  return res;
 }
 
 senmac_public
 void senarena_free(struct senarena arena) {
+  if senarena_unlikely(arena.cleanups != NULL) {
+    senarena_run_cleanups(&arena, NULL, 0);
+  }
+  if (arena.allocator.alloc != NULL && (arena.allocator.free == NULL || arena.bottom == 0)) return;
+  if (arena.regions != NULL) {
+    senarena_regions_free(arena.regions);
+    return;
+  }
   struct senarena_chunk_header *current = (struct senarena_chunk_header *) (arena.bottom- SENARENA_CHUNK_HEADER_SIZE);
-  senarena_free_chunk_chain(current);
-  senarena_free_chunk_chain(arena.fresh_chunks);
+  senarena_free_chunk_chain(&arena, current);
+  senarena_free_chunk_chain(&arena, arena.fresh_chunks);
+}
+
+senmac_public
+void senarena_free_deferred(struct senarena arena) {
+  // only plain malloced chunks can be freed by anyone, at any time
+  if (arena.allocator.alloc != NULL || arena.regions != NULL || arena.buffer != NULL) {
+    senarena_free(arena);
+    return;
+  }
+  if senarena_unlikely(arena.cleanups != NULL) {
+    senarena_run_cleanups(&arena, NULL, 0);
+  }
+  // the used chain ends at oldest, so the fresh chunks can go after it
+  arena.oldest->ptr = arena.fresh_chunks;
+  // default-sized chunks keep their order, so the most recently used ones
+  // are reused first
+  struct senarena_chunk_header *reusable = NULL;
+  struct senarena_chunk_header **reusable_end = &reusable;
+  struct senarena_chunk_header *leftovers = NULL;
+  struct senarena_chunk_header *chunk = (struct senarena_chunk_header *) (arena.bottom - SENARENA_CHUNK_HEADER_SIZE);
+  while (chunk != NULL) {
+    struct senarena_chunk_header *previous = chunk->ptr;
+    if senarena_likely(chunk->capacity == SENARENA_DEFAULT_CHUNK_SIZE) {
+      *reusable_end = chunk;
+      reusable_end = &chunk->ptr;
+    } else {
+      chunk->ptr = leftovers;
+      leftovers = chunk;
+    }
+    chunk = previous;
+  }
+  *reusable_end = NULL;
+  senarena_reclaim_push(reusable, leftovers);
+}
+
+senmac_public
+struct senarena_mark senarena_mark(const struct senarena *restrict arena) {
+  const struct senarena_chunk_header *current = (struct senarena_chunk_header*) (arena->bottom - SENARENA_CHUNK_HEADER_SIZE);
+  struct senarena_mark res = {
+    .top = arena->top,
+    .bottom = arena->bottom,
+    // an arena without a chunk has no chain
+    .previous = arena->bottom == 0 ? NULL : current->ptr,
+    .cleanups = arena->cleanups,
+    .cleanup_count = arena->cleanups == NULL ? 0 : arena->cleanups->count,
+  };
+#ifdef SENARENA_STATS
+  res.live_bytes = arena->stats.live_bytes;
+  res.padding_bytes = arena->stats.padding_bytes;
+#endif
+  return res;
+}
+
+// O(1), plus the cleanups
+senmac_public
+void senarena_rewind(struct senarena *restrict arena, struct senarena_mark mark) {
+  if senarena_unlikely(arena->cleanups != mark.cleanups || (mark.cleanups != NULL && mark.cleanups->count != mark.cleanup_count)) {
+    senarena_run_cleanups(arena, mark.cleanups, mark.cleanup_count);
+  }
+  // taken before the arena had a chunk, so everything since goes
+  if senarena_unlikely(mark.bottom == 0) {
+    senarena_clear(arena);
+    return;
+  }
+  struct senarena_chunk_header *marked = (struct senarena_chunk_header*) (mark.bottom - SENARENA_CHUNK_HEADER_SIZE);
+  struct senarena_chunk_header *current = (struct senarena_chunk_header*) (arena->bottom - SENARENA_CHUNK_HEADER_SIZE);
+
+  // chunks that were current after the mark, along with their
+  // dedicated chunks
+  if (current != marked) {
+    senarena_release_chunks(arena, current, marked->newer);
+    senarena_switch_chunk(arena, current, marked);
+  } else {
+    senarena_settle_zeroed(arena);
+  }
+
+  // dedicated chunks allocated while the marked chunk was current
+  if senarena_unlikely(marked->ptr != mark.previous) {
+    struct senarena_chunk_header *oldest;
+    if (mark.previous != NULL) {
+      oldest = mark.previous->newer;
+      mark.previous->newer = marked;
+    } else {
+      oldest = arena->oldest;
+      arena->oldest = marked;
+    }
+    senarena_release_chunks(arena, marked->ptr, oldest);
+    marked->ptr = mark.previous;
+  }
+
+  arena->top = mark.top;
+#ifdef SENARENA_STATS
+  arena->stats.peak_live_bytes = SENARENA_MAX(arena->stats.peak_live_bytes, arena->stats.live_bytes);
+  arena->stats.live_bytes = mark.live_bytes;
+  arena->stats.padding_bytes = mark.padding_bytes;
+#endif
+}
+
+// The most recent allocation sits at the top of the arena, and the free
+// space is below it, so resizing in place moves its start, and its contents.
+senmac_public
+void *senarena_realloc_last(struct senarena *restrict arena, void *ptr, size_t old_amount, size_t new_amount, size_t alignment) {
+  const size_t keep = SENARENA_MIN(old_amount, new_amount);
+  const uintptr_t start = (uintptr_t) ptr;
+  if (start == arena->top) {
+    const uintptr_t end = start + old_amount;
+    if (new_amount <= old_amount) {
+      const uintptr_t new_start = SENARENA_ALIGN_DOWN(end - new_amount, alignment);
+      if (new_start > start) {
+        memmove((void*) new_start, ptr, keep);
+        senarena_settle_zeroed(arena);
+        arena->top = new_start;
+        SENARENA_STAT(arena->stats.live_bytes -= new_start - start);
+      }
+      return (void*) arena->top;
+    }
+    const uintptr_t grow_by = new_amount - old_amount;
+    if (grow_by <= start - arena->bottom) {
+      const uintptr_t new_start = SENARENA_ALIGN_DOWN(start - grow_by, alignment);
+      if senarena_likely(new_start >= arena->bottom) {
+        memmove((void*) new_start, ptr, keep);
+        arena->top = new_start;
+        SENARENA_STAT(arena->stats.live_bytes += start - new_start);
+        return (void*) new_start;
+      }
+    }
+  }
+  const uintptr_t bottom = arena->bottom;
+  void *res = senarena_alloc(arena, new_amount, alignment);
+  if senarena_unlikely(res == NULL) return NULL;
+  memcpy(res, ptr, keep);
+  // a dedicated chunk was allocated, so the old allocation is still at
+  // the top of the current chunk, and we can have its space back
+  if (start == arena->top && arena->bottom == bottom) {
+    senarena_settle_zeroed(arena);
+    arena->top = start + old_amount;
+    SENARENA_STAT(arena->stats.live_bytes -= old_amount);
+  }
+  return res;
+}
+
+senmac_public
+struct senarena_buf senarena_buf_new(struct senarena *restrict arena, size_t alignment) {
+  struct senarena_buf res = {
+    .arena = arena,
+    .data = NULL,
+    .length = 0,
+    .capacity = 0,
+    .alignment = alignment,
+  };
+  return res;
+}
+
+senmac_public
+void *senarena_buf_reserve(struct senarena_buf *restrict buf, size_t amount) {
+  const size_t length = buf->length + amount;
+  if senarena_unlikely(length > buf->capacity) {
+    size_t capacity = buf->capacity == 0 ? 64 : buf->capacity * 2;
+    if (capacity < length) capacity = length;
+    unsigned char *data;
+    if (buf->data == NULL) {
+      data = (unsigned char*) senarena_alloc(buf->arena, capacity, buf->alignment);
+    } else {
+      data = (unsigned char*) senarena_realloc_last(buf->arena, buf->data, buf->capacity, capacity, buf->alignment);
+    }
+    if senarena_unlikely(data == NULL) return NULL;
+    buf->data = data;
+    buf->capacity = capacity;
+  }
+  void *res = buf->data + buf->length;
+  buf->length = length;
+  return res;
+}
+
+senmac_public
+bool senarena_buf_append(struct senarena_buf *restrict buf, const void *restrict data, size_t amount) {
+  void *dest = senarena_buf_reserve(buf, amount);
+  if senarena_unlikely(dest == NULL) return false;
+  memcpy(dest, data, amount);
+  return true;
+}
+
+senmac_public
+void *senarena_buf_finish(struct senarena_buf *restrict buf) {
+  if (buf->data != NULL && buf->length < buf->capacity) {
+    unsigned char *data = (unsigned char*) senarena_realloc_last(buf->arena, buf->data, buf->capacity, buf->length, buf->alignment);
+    // keeping the slack is fine, if shrinking needed a chunk we couldn't get
+    if senarena_likely(data != NULL) {
+      buf->data = data;
+      buf->capacity = buf->length;
+    }
+  }
+  return buf->data;
+}
+
+// Objects are a stride apart, so that they're all aligned
+static
+size_t senarena_stride(size_t amount, size_t alignment) {
+  return (amount + alignment - 1) & -alignment;
+}
+
+senmac_public
+size_t senarena_alloc_batch(struct senarena *restrict arena, size_t amount, size_t alignment, size_t count, void **restrict out) {
+  assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+  const size_t stride = senarena_stride(amount, alignment);
+  size_t done = 0;
+  while (done < count) {
+    const uintptr_t top = SENARENA_ALIGN_DOWN(arena->top, alignment);
+    const size_t fits = top < arena->bottom || stride == 0 ? 0 : (top - arena->bottom) / stride;
+    if senarena_unlikely(fits == 0) {
+      // moves on to a new chunk (or a dedicated one), for one object
+      const uintptr_t res = senarena_alloc_more(arena, amount, alignment);
+      if senarena_unlikely(res == 0) return done;
+      out[done++] = (void*) res;
+      continue;
+    }
+    const size_t n = SENARENA_MIN(fits, count - done);
+    const uintptr_t base = top - stride * n;
+    for (size_t i = 0; i < n; i++) {
+      out[done + i] = (void*) (base + stride * i);
+    }
+#ifdef SENARENA_STATS
+    arena->stats.live_bytes += amount * n;
+    arena->stats.padding_bytes += (arena->top - top) + (stride - amount) * n;
+#endif
+    arena->top = base;
+    done += n;
+  }
+  return done;
+}
+
+senmac_public
+void *senarena_alloc_contiguous(struct senarena *restrict arena, size_t amount, size_t alignment, size_t count) {
+  const size_t stride = senarena_stride(amount, alignment);
+  if senarena_unlikely(stride < amount || (count != 0 && stride > SIZE_MAX / count)) return NULL;
+  return senarena_alloc(arena, stride * count, alignment);
+}
+
+senmac_public
+void senarena_trim(struct senarena *restrict arena) {
+  // chunks that can't be freed on their own are kept for reuse
+  if (arena->allocator.alloc != NULL && arena->allocator.free == NULL) return;
+  if (arena->regions != NULL) {
+    // Chunks belong to their region, so we keep them, but let their
+    // (whole) pages go
+    for (struct senarena_chunk_header *chunk = arena->fresh_chunks; chunk != NULL; chunk = chunk->ptr) {
+      const uintptr_t start = (uintptr_t) chunk + SENARENA_CHUNK_HEADER_SIZE;
+      senarena_region_discard(start, start + chunk->capacity);
+    }
+  } else {
+    arena->fresh_chunks = senarena_free_chunk_chain(arena, arena->fresh_chunks);
+  }
+}
+
+static
+void *senarena_parent_alloc(void *context, size_t size) {
+  // like malloc, align chunks for any type
+  return senarena_alloc((struct senarena*) context, size, 16);
+}
+
+senmac_public
+struct senarena_allocator senarena_parent_allocator(struct senarena *restrict parent) {
+  struct senarena_allocator res = {
+    .alloc = senarena_parent_alloc,
+    .free = NULL,
+    .context = parent,
+  };
+  return res;
+}
+
+senmac_public
+struct senarena_stats senarena_stats(const struct senarena *restrict arena) {
+#ifdef SENARENA_STATS
+  struct senarena_stats res = arena->stats;
+  res.peak_live_bytes = SENARENA_MAX(res.peak_live_bytes, res.live_bytes);
+#else
+  (void) arena;
+  struct senarena_stats res = {0};
+#endif
+  return res;
 }
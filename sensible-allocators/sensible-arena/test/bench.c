@@ -8,6 +8,8 @@
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "sensible-test.h"
@@ -298,7 +300,8 @@ void print_aggregates(const char *name, struct aggregates aggs) {
     aggs.time_s.stddev);
 }
 
-int main(void) {
+static
+void bench_vs_malloc(void) {
   const unsigned long num_arena_allocations = determine_arena_alloc_amt();
   const unsigned long num_standard_allocations = determine_standard_alloc_amt();
 
@@ -465,3 +468,746 @@ int main(void) {
   printf("(reused) arena_alloc() vs malloc() speedup:   %.3f\n", arena_alloc_reused_aggregates.throughtput_us.mean / std_alloc_aggregates.throughtput_us.mean);
   printf("          arena_free() vs   free() speedup:   %.3f\n", arena_free_aggregates.throughtput_us.mean / std_free_aggregates.throughtput_us.mean);
 }
+
+#define THREAD_ROUNDS 5
+#define THREAD_SCOPES 1024
+#define THREAD_ALLOCATIONS_PER_SCOPE 4096
+
+#ifdef WIN32
+#include <windows.h>
+
+typedef HANDLE bench_thread;
+
+static
+unsigned num_cpus(void) {
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors;
+}
+
+static
+DWORD WINAPI thread_local_worker_win(LPVOID data);
+
+static
+bench_thread spawn_thread(void *data) {
+  return CreateThread(NULL, 0, thread_local_worker_win, data, 0, NULL);
+}
+
+static
+void join_thread(bench_thread thread) {
+  WaitForSingleObject(thread, INFINITE);
+  CloseHandle(thread);
+}
+#else
+#include <pthread.h>
+
+typedef pthread_t bench_thread;
+
+static
+unsigned num_cpus(void) {
+  long res = sysconf(_SC_NPROCESSORS_ONLN);
+  return res < 1 ? 1 : res;
+}
+
+static
+void *thread_local_worker_posix(void *data);
+
+static
+bench_thread spawn_thread(void *data) {
+  pthread_t res;
+  pthread_create(&res, NULL, thread_local_worker_posix, data);
+  return res;
+}
+
+static
+void join_thread(bench_thread thread) {
+  pthread_join(thread, NULL);
+}
+#endif
+
+// Each worker allocates in a thread-local arena, in a loop of
+// request-like scopes
+static
+void thread_local_worker(uint64_t *nanos) {
+  struct senarena *arena = senarena_thread_local();
+  const struct seninstant begin = seninstant_now();
+  for (int j = 0; j < THREAD_SCOPES; j++) {
+    senarena_scope_begin();
+    for (int i = 0; i < THREAD_ALLOCATIONS_PER_SCOPE; i++) {
+      volatile int *ints = senarena_alloc_array_of(arena, int, ints_to_allocate);
+      ints[1] = 42;
+    }
+    senarena_scope_end();
+  }
+  *nanos = seninstant_subtract(seninstant_now(), begin);
+}
+
+#ifdef WIN32
+static
+DWORD WINAPI thread_local_worker_win(LPVOID data) {
+  thread_local_worker((uint64_t*) data);
+  return 0;
+}
+#else
+static
+void *thread_local_worker_posix(void *data) {
+  thread_local_worker((uint64_t*) data);
+  return NULL;
+}
+#endif
+
+static
+unsigned next_thread_count(unsigned num_threads, unsigned cpus) {
+  if (num_threads == cpus) return cpus + 1;
+  return num_threads * 2 > cpus ? cpus : num_threads * 2;
+}
+
+static
+void bench_thread_local_scaling(void) {
+  const unsigned cpus = num_cpus();
+  const uint64_t allocations_per_thread = (uint64_t) THREAD_SCOPES * THREAD_ALLOCATIONS_PER_SCOPE;
+  bench_thread *threads = malloc(sizeof(bench_thread) * cpus);
+  uint64_t *nanos = malloc(sizeof(uint64_t) * cpus);
+  double single_thread_throughput = 0;
+
+  puts("# Thread-local arena scaling");
+  printf("Each thread does %" PRIu64 " allocations, in %d scopes.\n\n", allocations_per_thread, THREAD_SCOPES);
+
+  // powers of two, and then the number of CPUs
+  for (unsigned num_threads = 1; num_threads <= cpus; num_threads = next_thread_count(num_threads, cpus)) {
+    // best round, measured by the slowest thread in it
+    uint64_t best_nanos = UINT64_MAX;
+    for (int round = 0; round < THREAD_ROUNDS; round++) {
+      for (unsigned i = 0; i < num_threads; i++) {
+        threads[i] = spawn_thread(&nanos[i]);
+      }
+      uint64_t slowest = 0;
+      for (unsigned i = 0; i < num_threads; i++) {
+        join_thread(threads[i]);
+        if (nanos[i] > slowest) slowest = nanos[i];
+      }
+      if (slowest < best_nanos) best_nanos = slowest;
+    }
+    const double throughput = 1000 * (double) (allocations_per_thread * num_threads) / best_nanos;
+    if (num_threads == 1) single_thread_throughput = throughput;
+    printf("%3u thread(s): %10.3f ops/μs, %8.3f ops/μs/thread, scaling %.2fx (ideal %ux)\n",
+      num_threads,
+      throughput,
+      throughput / num_threads,
+      throughput / single_thread_throughput,
+      num_threads);
+  }
+  putchar('\n');
+
+  free(threads);
+  free(nanos);
+}
+
+#define POOL_THREADS 4
+#define POOL_TURNS 50
+#define POOL_ARENAS_PER_TURN 64
+#define POOL_MAX_ARENA_BYTES (1024 * 1024)
+#define POOL_ALLOCATION_SIZE 64
+
+#ifdef WIN32
+static
+void bench_chunk_pool(void) {
+  puts("# Shared chunk pool");
+  puts("Not supported on Windows.");
+}
+#else
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+static
+uint64_t count_chunks(struct senarena *arena) {
+  uint64_t res = 0;
+  struct senarena_chunk_header *chunk = (struct senarena_chunk_header*) (arena->bottom - sizeof(struct senarena_chunk_header));
+  for (; chunk != NULL; chunk = chunk->ptr) res++;
+  for (chunk = arena->fresh_chunks; chunk != NULL; chunk = chunk->ptr) res++;
+  return res;
+}
+
+// Threads take turns, so only one burst of arenas is alive at a time
+static pthread_mutex_t pool_turn_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_turn_changed = PTHREAD_COND_INITIALIZER;
+static int pool_turn;
+static uint64_t pool_chunks;
+
+// In each of its turns, a thread fills a burst of arenas of varying sizes,
+// all alive at once, then frees them
+static
+void *pool_worker(void *data) {
+  const int id = (int) (intptr_t) data;
+  struct senarena arenas[POOL_ARENAS_PER_TURN];
+  unsigned seed = id + 1;
+  for (int turn = id; turn < POOL_TURNS * POOL_THREADS; turn += POOL_THREADS) {
+    pthread_mutex_lock(&pool_turn_lock);
+    while (pool_turn != turn) pthread_cond_wait(&pool_turn_changed, &pool_turn_lock);
+    pthread_mutex_unlock(&pool_turn_lock);
+
+    for (int i = 0; i < POOL_ARENAS_PER_TURN; i++) {
+      arenas[i] = senarena_new();
+      seed = seed * 1664525 + 1013904223;
+      const int allocations = (seed >> 8) % (POOL_MAX_ARENA_BYTES / POOL_ALLOCATION_SIZE);
+      for (int j = 0; j < allocations; j++) {
+        volatile char *bytes = senarena_alloc(&arenas[i], POOL_ALLOCATION_SIZE, 8);
+        bytes[0] = 1;
+      }
+    }
+    uint64_t chunks = 0;
+    for (int i = 0; i < POOL_ARENAS_PER_TURN; i++) {
+      chunks += count_chunks(&arenas[i]);
+      senarena_free(arenas[i]);
+    }
+
+    pthread_mutex_lock(&pool_turn_lock);
+    pool_chunks += chunks;
+    pool_turn++;
+    pthread_cond_broadcast(&pool_turn_changed);
+    pthread_mutex_unlock(&pool_turn_lock);
+  }
+  return NULL;
+}
+
+static
+void pool_workload(bool use_pool) {
+  pthread_t threads[POOL_THREADS];
+  // enough for one burst
+  if (use_pool) senarena_pool_set_capacity(POOL_ARENAS_PER_TURN * POOL_MAX_ARENA_BYTES / 2);
+  const struct seninstant begin = seninstant_now();
+  for (int i = 0; i < POOL_THREADS; i++) {
+    pthread_create(&threads[i], NULL, pool_worker, (void*) (intptr_t) i);
+  }
+  for (int i = 0; i < POOL_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  const uint64_t nanos = seninstant_subtract(seninstant_now(), begin);
+  const uint64_t mallocs = use_pool ? senarena_pool_stats().misses : pool_chunks;
+  printf("%-12s %8.3fs, %10" PRIu64 " chunks, %10" PRIu64 " chunk mallocs",
+    use_pool ? "pooled:" : "unpooled:", ns_to_s(nanos), pool_chunks, mallocs);
+  if (use_pool) senarena_pool_set_capacity(0);
+}
+
+// Each variant runs in its own process, so that they have their own peak RSS
+static
+void bench_chunk_pool(void) {
+  puts("# Shared chunk pool");
+  printf("%d threads, taking %d turns each to fill %d arenas of up to %d bytes, all alive at once.\n\n",
+    POOL_THREADS, POOL_TURNS, POOL_ARENAS_PER_TURN, POOL_MAX_ARENA_BYTES);
+  fflush(stdout);
+  for (int use_pool = 0; use_pool <= 1; use_pool++) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+      pool_workload(use_pool);
+      struct rusage usage;
+      getrusage(RUSAGE_SELF, &usage);
+      // kilobytes on Linux, bytes on macOS
+      printf(", peak RSS %ld\n", usage.ru_maxrss);
+      exit(0);
+    }
+    waitpid(pid, NULL, 0);
+  }
+  putchar('\n');
+}
+#endif
+
+#define BACKEND_ROUNDS 5
+#define BACKEND_ALLOCATION_SIZE 64
+#define BACKEND_ALLOCATIONS (4 * 1024 * 1024)
+
+struct backend_times {
+  uint64_t alloc;
+  uint64_t access;
+  uint64_t free;
+};
+
+// Allocates lots of small objects, then touches them in a random order,
+// which is where the TLB misses show up
+static
+struct backend_times backend_round(struct senarena_config config, volatile uint64_t **ptrs) {
+  struct backend_times res;
+  struct senarena arena = senarena_new_with_config(config);
+  {
+    const struct seninstant begin = seninstant_now();
+    for (unsigned long i = 0; i < BACKEND_ALLOCATIONS; i++) {
+      volatile uint64_t *obj = senarena_alloc(&arena, BACKEND_ALLOCATION_SIZE, 8);
+      obj[0] = i;
+      ptrs[i] = obj;
+    }
+    res.alloc = seninstant_subtract(seninstant_now(), begin);
+  }
+  {
+    uint64_t sum = 0;
+    uint32_t index = 1;
+    const struct seninstant begin = seninstant_now();
+    for (unsigned long i = 0; i < BACKEND_ALLOCATIONS; i++) {
+      // LCG, BACKEND_ALLOCATIONS is a power of two
+      index = index * 1664525 + 1013904223;
+      sum += *ptrs[index % BACKEND_ALLOCATIONS];
+    }
+    res.access = seninstant_subtract(seninstant_now(), begin);
+    volatile uint64_t sink = sum;
+    (void) sink;
+  }
+  {
+    const struct seninstant begin = seninstant_now();
+    senarena_free(arena);
+    res.free = seninstant_subtract(seninstant_now(), begin);
+  }
+  return res;
+}
+
+static
+void bench_backends(void) {
+  static const char *names[] = {"malloc", "mmap", "mmap (huge pages)"};
+  struct senarena_config configs[] = {
+    { .backend = SENARENA_BACKEND_MALLOC, .huge_pages = false },
+    { .backend = SENARENA_BACKEND_MMAP, .huge_pages = false },
+    { .backend = SENARENA_BACKEND_MMAP, .huge_pages = true },
+  };
+  volatile uint64_t **ptrs = malloc(sizeof(uint64_t*) * BACKEND_ALLOCATIONS);
+
+  puts("# Chunk backends");
+  printf("%d allocations of %d bytes, best of %d rounds.\n\n", BACKEND_ALLOCATIONS, BACKEND_ALLOCATION_SIZE, BACKEND_ROUNDS);
+  for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+    struct backend_times best = { UINT64_MAX, UINT64_MAX, UINT64_MAX };
+    for (int round = 0; round < BACKEND_ROUNDS; round++) {
+      struct backend_times times = backend_round(configs[i], ptrs);
+      if (times.alloc < best.alloc) best.alloc = times.alloc;
+      if (times.access < best.access) best.access = times.access;
+      if (times.free < best.free) best.free = times.free;
+    }
+    printf("%-18s alloc %8.3f ops/μs, random access %8.3f ops/μs, free %.4fs\n",
+      names[i],
+      1000 * (double) BACKEND_ALLOCATIONS / best.alloc,
+      1000 * (double) BACKEND_ALLOCATIONS / best.access,
+      ns_to_s(best.free));
+  }
+  putchar('\n');
+  free(ptrs);
+}
+
+#define CLEAR_ROUNDS 200
+#define CLEAR_ALLOCATION_SIZE 1000
+
+// Allocates enough to use `chunks` default-sized chunks
+static
+void fill_chunks(struct senarena *arena, unsigned long chunks) {
+  const unsigned long per_chunk = SENARENA_DEFAULT_CHUNK_SIZE / CLEAR_ALLOCATION_SIZE;
+  for (unsigned long i = 0; i < chunks * per_chunk; i++) {
+    volatile char *bytes = senarena_alloc(arena, CLEAR_ALLOCATION_SIZE, 8);
+    bytes[0] = 1;
+  }
+}
+
+// Reads the chunk headers senarena_clear touches, and runs it (and the
+// clock) on a small arena, so that timing it doesn't time cache misses on
+// its headers and code too
+static
+void warm_clear(struct senarena *arena, struct senarena *small) {
+  const struct senarena_chunk_header *current = (const struct senarena_chunk_header*) (arena->bottom - sizeof(struct senarena_chunk_header));
+  volatile uintptr_t sink = (uintptr_t) current->ptr + current->capacity + (uintptr_t) arena->oldest->ptr;
+  (void) sink;
+  fill_chunks(small, 2);
+  const struct seninstant begin = seninstant_now();
+  senarena_clear(small);
+  sink = seninstant_subtract(seninstant_now(), begin);
+}
+
+// Each round uses half of the arena's chunks, like a request that's smaller
+// than the largest one so far, so that both the used and the reusable
+// chunk chains are long when it's cleared. Filling them evicts the
+// current and oldest chunks' headers, and senarena_clear's code, from
+// cache, in bigger arenas, which the cold clears pay for, and the warm
+// ones don't.
+static
+void bench_clear(void) {
+  static const unsigned long sizes[] = {16, 256, 4096, 65536};
+
+  puts("# Clearing");
+  printf("Mean of %d clears, each after using half of the arena's chunks.\n\n", CLEAR_ROUNDS);
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    struct senarena arena = senarena_new();
+    struct senarena small = senarena_new();
+    fill_chunks(&arena, sizes[i]);
+    senarena_clear(&arena);
+    uint64_t cold_nanos = 0;
+    uint64_t warm_nanos = 0;
+    for (int round = 0; round < CLEAR_ROUNDS; round++) {
+      const bool warm = round % 2 == 1;
+      fill_chunks(&arena, sizes[i] / 2);
+      if (warm) warm_clear(&arena, &small);
+      const struct seninstant begin = seninstant_now();
+      senarena_clear(&arena);
+      const uint64_t nanos = seninstant_subtract(seninstant_now(), begin);
+      if (warm) {
+        warm_nanos += nanos;
+      } else {
+        cold_nanos += nanos;
+      }
+    }
+    printf("%6lu chunks: %10.1f ns per clear, %10.1f ns warm\n",
+      sizes[i],
+      (double) cold_nanos / (CLEAR_ROUNDS / 2),
+      (double) warm_nanos / (CLEAR_ROUNDS / 2));
+    senarena_free(small);
+    senarena_free(arena);
+  }
+  putchar('\n');
+}
+
+#define BATCH_ROUNDS 20
+#define BATCH_NODES (1024 * 1024)
+
+struct batch_node {
+  struct batch_node *left;
+  struct batch_node *right;
+  uint64_t key;
+};
+
+// Allocates an array's worth of independently addressable nodes, in a
+// reused arena, one at a time, and as a batch
+static
+void bench_batch(void) {
+  static const size_t batch_sizes[] = {16, 256, 4096, BATCH_NODES};
+  struct batch_node **nodes = malloc(sizeof(struct batch_node*) * BATCH_NODES);
+  struct senarena arena = senarena_new();
+
+  puts("# Batch allocation");
+  printf("%d nodes of %zu bytes, best of %d rounds, in a reused arena.\n\n", BATCH_NODES, sizeof(struct batch_node), BATCH_ROUNDS);
+
+  uint64_t loop_nanos = UINT64_MAX;
+  for (int round = 0; round < BATCH_ROUNDS; round++) {
+    senarena_clear(&arena);
+    const struct seninstant begin = seninstant_now();
+    for (unsigned long i = 0; i < BATCH_NODES; i++) {
+      nodes[i] = senarena_alloc_type(&arena, struct batch_node);
+    }
+    const uint64_t nanos = seninstant_subtract(seninstant_now(), begin);
+    nodes[BATCH_NODES - 1]->key = 42;
+    if (nanos < loop_nanos) loop_nanos = nanos;
+  }
+  printf("%-20s %8.3f nodes/μs\n", "senarena_alloc loop:", 1000 * (double) BATCH_NODES / loop_nanos);
+
+  for (size_t i = 0; i < sizeof(batch_sizes) / sizeof(batch_sizes[0]); i++) {
+    uint64_t batch_nanos = UINT64_MAX;
+    for (int round = 0; round < BATCH_ROUNDS; round++) {
+      senarena_clear(&arena);
+      const struct seninstant begin = seninstant_now();
+      for (unsigned long j = 0; j < BATCH_NODES; j += batch_sizes[i]) {
+        senarena_alloc_batch(&arena, sizeof(struct batch_node), SENARENA_ALIGNOF(struct batch_node), batch_sizes[i], (void**) &nodes[j]);
+      }
+      const uint64_t nanos = seninstant_subtract(seninstant_now(), begin);
+      nodes[BATCH_NODES - 1]->key = 42;
+      if (nanos < batch_nanos) batch_nanos = nanos;
+    }
+    printf("batches of %-9zu %8.3f nodes/μs, speedup %.3f\n",
+      batch_sizes[i],
+      1000 * (double) BATCH_NODES / batch_nanos,
+      (double) loop_nanos / batch_nanos);
+  }
+  putchar('\n');
+  senarena_free(arena);
+  free(nodes);
+}
+
+#define ALIGNMENT_ROUNDS 5
+#define ALIGNMENT_LIVE_BYTES (64 * 1024 * 1024)
+#define ALIGNMENT_SMALL_BUFFERS 256
+#define ALIGNMENT_SMALL_FILLER (16 * 1024)
+
+// bytes the arena's chunks were allocated with, including their headers
+static size_t alignment_chunk_bytes;
+
+static
+void *alignment_chunk_alloc(void *context, size_t size) {
+  (void) context;
+  alignment_chunk_bytes += size;
+  return malloc(size);
+}
+
+static
+void alignment_chunk_free(void *context, void *ptr, size_t size) {
+  (void) context;
+  (void) size;
+  free(ptr);
+}
+
+// Fills an arena with buffers as big as they are aligned, like cache lines
+// for SIMD, or pages and huge pages for I/O, and compares the chunk bytes
+// it took with the bytes allocated
+static
+void bench_alignment(void) {
+  static const size_t alignments[] = {64, 4096, 2 * 1024 * 1024};
+  const struct senarena_config config = {
+    .allocator = { .alloc = alignment_chunk_alloc, .free = alignment_chunk_free, .context = NULL },
+  };
+
+  puts("# Large alignments");
+  printf("%d MiB of buffers, each as big as its alignment, best of %d rounds, in a new arena.\n\n", ALIGNMENT_LIVE_BYTES / (1024 * 1024), ALIGNMENT_ROUNDS);
+  for (size_t i = 0; i < sizeof(alignments) / sizeof(alignments[0]); i++) {
+    const size_t alignment = alignments[i];
+    const size_t count = ALIGNMENT_LIVE_BYTES / alignment;
+    uint64_t best = UINT64_MAX;
+    size_t chunk_bytes = 0;
+    for (int round = 0; round < ALIGNMENT_ROUNDS; round++) {
+      alignment_chunk_bytes = 0;
+      struct senarena arena = senarena_new_with_config(config);
+      const struct seninstant begin = seninstant_now();
+      for (size_t j = 0; j < count; j++) {
+        volatile char *buf = senarena_alloc(&arena, alignment, alignment);
+        buf[0] = 1;
+      }
+      const uint64_t nanos = seninstant_subtract(seninstant_now(), begin);
+      if (nanos < best) best = nanos;
+      chunk_bytes = alignment_chunk_bytes;
+      senarena_free(arena);
+    }
+    printf("%8zu bytes: %10.1f ns per buffer, %9.1f MiB of chunks, overhead %6.1f%%\n",
+      alignment,
+      (double) best / count,
+      chunk_bytes / (1024.0 * 1024.0),
+      100.0 * (chunk_bytes - ALIGNMENT_LIVE_BYTES) / ALIGNMENT_LIVE_BYTES);
+  }
+  putchar('\n');
+
+  // Buffers much smaller than their alignment, each among small unaligned
+  // allocations, first in a new arena, then again after clearing it, where
+  // the chunks the first cycle left should be reused
+  static const struct { size_t size, alignment; } small[] = {
+    {64, 2 * 1024 * 1024},
+    {2000, 4096},
+  };
+  printf("%d buffers much smaller than their alignment, each after %d KiB of 32 byte allocations.\n\n", ALIGNMENT_SMALL_BUFFERS, ALIGNMENT_SMALL_FILLER / 1024);
+  for (size_t i = 0; i < sizeof(small) / sizeof(small[0]); i++) {
+    alignment_chunk_bytes = 0;
+    struct senarena arena = senarena_new_with_config(config);
+    size_t cycle_bytes[2];
+    for (int cycle = 0; cycle < 2; cycle++) {
+      const size_t before = alignment_chunk_bytes;
+      for (int j = 0; j < ALIGNMENT_SMALL_BUFFERS; j++) {
+        for (int k = 0; k < ALIGNMENT_SMALL_FILLER / 32; k++) {
+          volatile char *filler = senarena_alloc(&arena, 32, 8);
+          filler[0] = 1;
+        }
+        volatile char *buf = senarena_alloc(&arena, small[i].size, small[i].alignment);
+        buf[0] = 1;
+      }
+      cycle_bytes[cycle] = alignment_chunk_bytes - before;
+      senarena_clear(&arena);
+    }
+    senarena_free(arena);
+    const size_t live = ALIGNMENT_SMALL_BUFFERS * (small[i].size + ALIGNMENT_SMALL_FILLER);
+    printf("%8zu bytes at %7zu: %9.1f MiB of chunks (%.1f MiB live), %9.1f MiB more after a clear\n",
+      small[i].size,
+      small[i].alignment,
+      cycle_bytes[0] / (1024.0 * 1024.0),
+      live / (1024.0 * 1024.0),
+      cycle_bytes[1] / (1024.0 * 1024.0));
+  }
+  putchar('\n');
+}
+
+// With no arguments every benchmark is run, otherwise only the named ones
+static
+bool bench_selected(int argc, char **argv, const char *name) {
+  if (argc <= 1) return true;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return true;
+  }
+  return false;
+}
+
+#define IMAGE_ENTRIES (1024 * 1024)
+#define IMAGE_LOOKUPS 1000
+#define IMAGE_PATH "sensible-arena-bench.img"
+
+struct image_entry {
+  struct senarena_relptr next;
+  struct senarena_relptr key;
+  uint64_t value;
+};
+
+struct image_table {
+  // a power of two
+  size_t capacity;
+  struct senarena_relptr buckets[];
+};
+
+static
+size_t image_hash(const char *key) {
+  // FNV-1a
+  uint64_t res = UINT64_C(14695981039346656037);
+  for (; *key != '\0'; key++) {
+    res ^= (unsigned char) *key;
+    res *= UINT64_C(1099511628211);
+  }
+  return (size_t) res;
+}
+
+static
+struct image_table *image_build(struct senarena *arena) {
+  const size_t capacity = IMAGE_ENTRIES;
+  // SENARENA_ALIGNOF can't take a struct with a flexible array member, so
+  // it's the alignment of its fields
+  const size_t alignment = SENARENA_MAX(SENARENA_ALIGNOF(size_t), SENARENA_ALIGNOF(struct senarena_relptr));
+  struct image_table *table = senarena_alloc_zeroed(arena, sizeof(struct image_table) + capacity * sizeof(struct senarena_relptr), alignment);
+  table->capacity = capacity;
+  for (uint64_t i = 0; i < IMAGE_ENTRIES; i++) {
+    struct image_entry *entry = senarena_alloc_type(arena, struct image_entry);
+    const char *key = senarena_sprintf(arena, "key-%" PRIu64, i);
+    struct senarena_relptr *bucket = &table->buckets[image_hash(key) & (capacity - 1)];
+    senarena_relptr_set(&entry->key, key);
+    senarena_relptr_set(&entry->next, senarena_relptr_get(bucket));
+    entry->value = i * i;
+    senarena_relptr_set(bucket, entry);
+  }
+  return table;
+}
+
+static
+uint64_t image_lookups(const struct image_table *table) {
+  uint64_t res = 0;
+  for (uint64_t i = 0; i < IMAGE_LOOKUPS; i++) {
+    char key[32];
+    snprintf(key, sizeof(key), "key-%" PRIu64, i * (IMAGE_ENTRIES / IMAGE_LOOKUPS));
+    const struct image_entry *entry = senarena_relptr_get(&table->buckets[image_hash(key) & (table->capacity - 1)]);
+    while (entry != NULL && strcmp(senarena_relptr_get(&entry->key), key) != 0) {
+      entry = senarena_relptr_get(&entry->next);
+    }
+    if (entry != NULL) res += entry->value;
+  }
+  return res;
+}
+
+static
+void bench_image(void) {
+  puts("# Arena images");
+  printf("A hash table of %d strings, built from scratch, or loaded from an image, and then looked up %d times.\n\n", IMAGE_ENTRIES, IMAGE_LOOKUPS);
+
+  struct seninstant begin = seninstant_now();
+  struct senarena_image image = senarena_image_new((size_t) 1024 * 1024 * 1024);
+  const struct image_table *table = image_build(&image.arena);
+  const uint64_t built_sum = image_lookups(table);
+  const uint64_t build_nanos = seninstant_subtract(seninstant_now(), begin);
+
+  begin = seninstant_now();
+  if (!senarena_image_save(&image, table, IMAGE_PATH)) {
+    puts("Couldn't save the image\n");
+    senarena_image_free(image);
+    return;
+  }
+  const uint64_t save_nanos = seninstant_subtract(seninstant_now(), begin);
+  const size_t size = senarena_image_size(&image);
+  senarena_image_free(image);
+
+  begin = seninstant_now();
+  struct senarena_loaded_image loaded = senarena_image_load(IMAGE_PATH);
+  const uint64_t loaded_sum = image_lookups(loaded.root);
+  const uint64_t load_nanos = seninstant_subtract(seninstant_now(), begin);
+
+  printf("%-16s %10.3f ms\n", "build:", build_nanos / 1e6);
+  printf("%-16s %10.3f ms (%.1f MiB)\n", "save:", save_nanos / 1e6, size / (1024.0 * 1024.0));
+  printf("%-16s %10.3f ms, speedup %.1f%s\n\n",
+    "load:",
+    load_nanos / 1e6,
+    (double) build_nanos / load_nanos,
+    built_sum == loaded_sum ? "" : " (but the lookups differ!)");
+  senarena_image_unload(loaded);
+  remove(IMAGE_PATH);
+}
+
+#define DEFERRED_REQUESTS 20000
+#define DEFERRED_ALLOCATIONS 256
+#define DEFERRED_RECLAIM_EVERY 64
+
+static
+int compare_u64(const void *a, const void *b) {
+  const uint64_t x = *(const uint64_t*) a;
+  const uint64_t y = *(const uint64_t*) b;
+  return x < y ? -1 : x > y;
+}
+
+// Each request gets its own arena, fills a few dozen chunks, and frees it
+// before it's done. Returns the mean time spent freeing.
+// With reclaim_nanos, it reclaims every DEFERRED_RECLAIM_EVERY requests,
+// and adds up the time that took.
+static
+double deferred_workload(bool deferred, uint64_t *latencies, uint64_t *reclaim_nanos) {
+  uint32_t seed = 42;
+  uint64_t free_nanos = 0;
+  for (int i = 0; i < DEFERRED_REQUESTS; i++) {
+    const struct seninstant begin = seninstant_now();
+    struct senarena arena = senarena_new();
+    for (int j = 0; j < DEFERRED_ALLOCATIONS; j++) {
+      seed = seed * 1103515245 + 12345;
+      volatile char *ptr = senarena_alloc(&arena, 16 + (seed >> 16) % 1024, 8);
+      *ptr = 1;
+    }
+    const struct seninstant free_begin = seninstant_now();
+    if (deferred) {
+      senarena_free_deferred(arena);
+    } else {
+      senarena_free(arena);
+    }
+    const struct seninstant end = seninstant_now();
+    free_nanos += seninstant_subtract(end, free_begin);
+    latencies[i] = seninstant_subtract(end, begin);
+    if (reclaim_nanos != NULL && (i + 1) % DEFERRED_RECLAIM_EVERY == 0) {
+      senarena_reclaim();
+      *reclaim_nanos += seninstant_subtract(seninstant_now(), end);
+    }
+  }
+  qsort(latencies, DEFERRED_REQUESTS, sizeof(uint64_t), compare_u64);
+  return (double) free_nanos / DEFERRED_REQUESTS;
+}
+
+static
+void print_latencies(const char *name, double free_nanos, const uint64_t *latencies) {
+  printf("%-22s free %7.0f ns, request p50 %6.2f μs, p99 %6.2f μs, max %7.2f μs\n",
+    name,
+    free_nanos,
+    latencies[DEFERRED_REQUESTS / 2] / 1e3,
+    latencies[DEFERRED_REQUESTS * 99 / 100] / 1e3,
+    latencies[DEFERRED_REQUESTS - 1] / 1e3);
+}
+
+static
+void bench_deferred(void) {
+  uint64_t *latencies = malloc(sizeof(uint64_t) * DEFERRED_REQUESTS);
+  puts("# Deferred freeing");
+  printf("%d requests, each with its own arena of %d allocations (about %d chunks).\n\n",
+    DEFERRED_REQUESTS,
+    DEFERRED_ALLOCATIONS,
+    (int) (DEFERRED_ALLOCATIONS * 528 / SENARENA_DEFAULT_CHUNK_SIZE));
+
+  // warm up malloc
+  deferred_workload(false, latencies, NULL);
+  double free_nanos = deferred_workload(false, latencies, NULL);
+  print_latencies("senarena_free:", free_nanos, latencies);
+
+  senarena_reclaimer_start();
+  free_nanos = deferred_workload(true, latencies, NULL);
+  senarena_reclaimer_stop();
+  print_latencies("reclaimer thread:", free_nanos, latencies);
+
+  // a safe point, every so many requests
+  uint64_t reclaim_nanos = 0;
+  free_nanos = deferred_workload(true, latencies, &reclaim_nanos);
+  print_latencies("senarena_reclaim:", free_nanos, latencies);
+  printf("(%.1f μs per senarena_reclaim, every %d requests)\n\n", reclaim_nanos / 1e3 / (DEFERRED_REQUESTS / DEFERRED_RECLAIM_EVERY), DEFERRED_RECLAIM_EVERY);
+  free(latencies);
+}
+
+int main(int argc, char **argv) {
+  if (bench_selected(argc, argv, "malloc")) bench_vs_malloc();
+  if (bench_selected(argc, argv, "threads")) bench_thread_local_scaling();
+  if (bench_selected(argc, argv, "pool")) bench_chunk_pool();
+  if (bench_selected(argc, argv, "backends")) bench_backends();
+  if (bench_selected(argc, argv, "clear")) bench_clear();
+  if (bench_selected(argc, argv, "batch")) bench_batch();
+  if (bench_selected(argc, argv, "image")) bench_image();
+  if (bench_selected(argc, argv, "deferred")) bench_deferred();
+  if (bench_selected(argc, argv, "alignment")) bench_alignment();
+}
@@ -0,0 +1,52 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: CC0-1.0
+
+// Allocations of the same types, through the generic inlined path, and
+// through SENARENA_DEFINE_ALLOCATOR, compiled on their own, so that the
+// sensible-arena-codegen target can count their instructions.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sensible-arena.h"
+
+struct codegen_node {
+  struct codegen_node *left;
+  struct codegen_node *right;
+  uint64_t key;
+};
+
+struct codegen_vec3 {
+  float x;
+  float y;
+  float z;
+};
+
+SENARENA_DEFINE_ALLOCATOR(codegen_node_alloc, struct codegen_node)
+SENARENA_DEFINE_ALLOCATOR(codegen_vec3_alloc, struct codegen_vec3)
+
+struct codegen_node *generic_node(struct senarena *arena) {
+  return senarena_alloc_type(arena, struct codegen_node);
+}
+
+struct codegen_node *specialized_node(struct senarena *arena) {
+  return codegen_node_alloc(arena);
+}
+
+struct codegen_vec3 *generic_vec3(struct senarena *arena) {
+  return senarena_alloc_type(arena, struct codegen_vec3);
+}
+
+struct codegen_vec3 *specialized_vec3(struct senarena *arena) {
+  return codegen_vec3_alloc(arena);
+}
+
+// unlike the specialized one, this doesn't check count * size for overflow
+struct codegen_node *generic_node_array(struct senarena *arena, size_t count) {
+  return senarena_alloc_array_of(arena, struct codegen_node, count);
+}
+
+struct codegen_node *specialized_node_array(struct senarena *arena, size_t count) {
+  return codegen_node_alloc_array(arena, count);
+}
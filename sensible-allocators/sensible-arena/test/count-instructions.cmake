@@ -0,0 +1,40 @@
+# SPDX-FileCopyrightText: 2023 The libsensible Authors
+#
+# SPDX-License-Identifier: CC0-1.0
+
+# Counts the instructions of each function in the objdump output at
+# DISASSEMBLY, up to its first return (the fast path), and in total,
+# skipping the out-of-line copies of sensible-arena's inline functions.
+# cmake -DDISASSEMBLY=codegen.s -P count-instructions.cmake
+
+file(STRINGS ${DISASSEMBLY} lines)
+set(name "")
+foreach(line IN LISTS lines)
+  if(line MATCHES "^[0-9a-f]+ <([A-Za-z_0-9]+)>:$")
+    if(NOT name STREQUAL "")
+      message("${name}: ${fast} fast path, ${total} total")
+    endif()
+    set(name ${CMAKE_MATCH_1})
+    if(name MATCHES "^senarena_")
+      set(name "")
+    endif()
+    set(fast 0)
+    set(total 0)
+    set(returned FALSE)
+  elseif(NOT name STREQUAL "" AND line MATCHES "^ +[0-9a-f]+:\t([a-z0-9]+)")
+    set(mnemonic ${CMAKE_MATCH_1})
+    # padding between functions
+    if(NOT mnemonic MATCHES "^(nop|nopl|nopw|xchg|int3|cs|data16)$")
+      math(EXPR total "${total} + 1")
+      if(NOT returned)
+        math(EXPR fast "${fast} + 1")
+      endif()
+      if(mnemonic MATCHES "^ret")
+        set(returned TRUE)
+      endif()
+    endif()
+  endif()
+endforeach()
+if(NOT name STREQUAL "")
+  message("${name}: ${fast} fast path, ${total} total")
+endif()
@@ -0,0 +1,146 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: CC0-1.0
+
+// An allocation-heavy program, which only knows about malloc, apart from
+// opening an arena scope per request. Run it as is, and with
+// sensible-arena-malloc preloaded, to compare the two.
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sensible-timing.h"
+#include "sensible-arena.h"
+
+#define ROUNDS 10
+#define REQUESTS (64 * 1024)
+#define HEADERS 64
+#define HEADER_NAMES 32
+
+static char header_names[HEADER_NAMES][16];
+
+struct header {
+  struct header *next;
+  char *name;
+  char *value;
+};
+
+struct node {
+  struct node *left;
+  struct node *right;
+  const char *key;
+  uint64_t hits;
+};
+
+static
+uint32_t next_random(uint32_t *state) {
+  // xorshift32
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static
+char *copy_string(const char *str, size_t length) {
+  char *res = malloc(length + 1);
+  memcpy(res, str, length);
+  res[length] = '\0';
+  return res;
+}
+
+static
+void count_key(struct node **root, const char *key) {
+  while (*root != NULL) {
+    const int cmp = strcmp(key, (*root)->key);
+    if (cmp == 0) {
+      (*root)->hits++;
+      return;
+    }
+    root = cmp < 0 ? &(*root)->left : &(*root)->right;
+  }
+  struct node *node = calloc(1, sizeof(struct node));
+  node->key = key;
+  node->hits = 1;
+  *root = node;
+}
+
+static
+uint64_t free_tree(struct node *node) {
+  if (node == NULL) return 0;
+  const uint64_t res = node->hits * node->hits + free_tree(node->left) + free_tree(node->right);
+  free(node);
+  return res;
+}
+
+// Parses some headers into a list, counts them in a tree, and renders a
+// response into a growing buffer, then frees everything
+static
+uint64_t handle_request(uint32_t *seed) {
+  static const char filler[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  struct header *headers = NULL;
+  struct node *counts = NULL;
+  char *response = NULL;
+  size_t length = 0;
+  size_t capacity = 0;
+  for (int i = 0; i < HEADERS; i++) {
+    const char *name = header_names[next_random(seed) % HEADER_NAMES];
+    const size_t name_length = strlen(name);
+    const size_t value_length = 8 + next_random(seed) % 48;
+    struct header *header = malloc(sizeof(struct header));
+    header->name = copy_string(name, name_length);
+    header->value = copy_string(filler, value_length);
+    header->next = headers;
+    headers = header;
+    count_key(&counts, header->name);
+    const size_t line_length = name_length + value_length + 3;
+    if (length + line_length > capacity) {
+      capacity = capacity == 0 ? 128 : capacity * 2;
+      response = realloc(response, capacity);
+    }
+    memcpy(response + length, header->name, name_length);
+    memcpy(response + length + name_length, ": ", 2);
+    memcpy(response + length + name_length + 2, header->value, value_length);
+    length += line_length;
+    response[length - 1] = '\n';
+  }
+  uint64_t res = length + free_tree(counts);
+  while (headers != NULL) {
+    struct header *next = headers->next;
+    free(headers->name);
+    free(headers->value);
+    free(headers);
+    headers = next;
+  }
+  free(response);
+  return res;
+}
+
+int main(int argc, char **argv) {
+  const char *label = argc > 1 ? argv[1] : "malloc";
+  for (int i = 0; i < HEADER_NAMES; i++) {
+    snprintf(header_names[i], sizeof(header_names[i]), "x-header-%d", i);
+  }
+  uint64_t best = UINT64_MAX;
+  uint64_t checksum = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    uint32_t seed = 42;
+    checksum = 0;
+    const struct seninstant begin = seninstant_now();
+    for (int i = 0; i < REQUESTS; i++) {
+      senarena_scope_begin();
+      checksum += handle_request(&seed);
+      senarena_scope_end();
+    }
+    const uint64_t nanos = seninstant_subtract(seninstant_now(), begin);
+    if (nanos < best) best = nanos;
+  }
+  printf("%-9s %8.3f requests/ms (checksum %" PRIu64 ")\n", label, 1e6 * REQUESTS / best, checksum);
+  senarena_thread_local_free();
+  return 0;
+}
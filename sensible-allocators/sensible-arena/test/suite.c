@@ -4,6 +4,8 @@
 
 #include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -12,6 +14,10 @@
 #include "sensible-test.h"
 #include "sensible-macros.h"
 
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
 #define STATIC_LEN(arr) (sizeof(arr) / sizeof((arr)[0]))
 
 static
@@ -19,6 +25,143 @@ int one_in(int n) {
   return rand() % n == 0;
 }
 
+static
+size_t chain_length(const struct senarena_chunk_header *chunk) {
+  size_t res = 0;
+  for (; chunk != NULL; chunk = chunk->ptr) {
+    res++;
+  }
+  return res;
+}
+
+static
+const struct senarena_chunk_header *current_chunk(const struct senarena *arena) {
+  return (const struct senarena_chunk_header*) (arena->bottom - sizeof(struct senarena_chunk_header));
+}
+
+static
+bool all_zero(const void *ptr, size_t amount) {
+  const unsigned char *bytes = ptr;
+  for (size_t i = 0; i < amount; i++) {
+    if (bytes[i] != 0) return false;
+  }
+  return true;
+}
+
+// Records the order cleanups run in
+struct cleanup_log {
+  int order[64];
+  size_t length;
+};
+
+struct cleanup_entry {
+  struct cleanup_log *log;
+  int id;
+};
+
+static
+void log_cleanup(void *context) {
+  struct cleanup_entry *entry = context;
+  entry->log->order[entry->log->length++] = entry->id;
+}
+
+// Counts its chunks, and fails once `remaining` reaches zero
+struct counting_allocator {
+  size_t outstanding;
+  size_t remaining;
+};
+
+static
+void *counting_alloc(void *context, size_t size) {
+  struct counting_allocator *counts = context;
+  if (counts->remaining == 0) return NULL;
+  counts->remaining--;
+  counts->outstanding++;
+  return malloc(size);
+}
+
+static
+void counting_free(void *context, void *ptr, size_t size) {
+  (void) size;
+  struct counting_allocator *counts = context;
+  counts->outstanding--;
+  free(ptr);
+}
+
+static
+struct senarena new_counting_arena(struct counting_allocator *counts) {
+  struct senarena_config config = {
+    .allocator = { .alloc = counting_alloc, .free = counting_free, .context = counts },
+  };
+  return senarena_new_with_config(config);
+}
+
+struct typed_node {
+  struct typed_node *next;
+  uint32_t key;
+};
+
+SENARENA_DEFINE_ALLOCATOR(typed_node_alloc, struct typed_node)
+SENARENA_DEFINE_ALLOCATOR(typed_char_alloc, char)
+// more aligned than chunks have to be, on most platforms
+SENARENA_DEFINE_ALLOCATOR(typed_long_double_alloc, long double)
+
+static
+bool is_aligned(const void *ptr, size_t alignment) {
+  return ((uintptr_t) ptr & (alignment - 1)) == 0;
+}
+
+#define IMAGE_PATH "sensible-arena-test.img"
+
+// A list that only refers to itself with relative pointers
+struct image_node {
+  struct senarena_relptr next;
+  struct senarena_relptr name;
+  int value;
+};
+
+// Builds a list of count nodes, in the image's arena, and returns its head
+static
+struct image_node *build_image_list(struct senarena_image *image, int count) {
+  struct image_node *head = NULL;
+  for (int i = 0; i < count; i++) {
+    struct image_node *node = senarena_alloc_type(&image->arena, struct image_node);
+    senarena_relptr_set(&node->next, head);
+    senarena_relptr_set(&node->name, senarena_sprintf(&image->arena, "node %d", i));
+    node->value = i;
+    head = node;
+  }
+  return head;
+}
+
+#ifndef _WIN32
+// Compares with the arena passed in while this thread's is still alive,
+// since an exited thread's arena could be handed out again
+static
+void *compare_thread_local_arena(void *data) {
+  struct senarena *arena = senarena_thread_local();
+  volatile int *a = senarena_alloc_type(arena, int);
+  *a = 42;
+  const bool different = arena != (struct senarena*) data;
+  return different ? data : NULL;
+}
+
+// Churns through arenas, so that their chunks go through the pool
+static
+void *churn_pooled_arenas(void *data) {
+  (void) data;
+  for (int i = 0; i < 2000; i++) {
+    struct senarena arena = senarena_new();
+    for (int j = 0; j < 64; j++) {
+      volatile char *bytes = senarena_alloc(&arena, 256, 8);
+      bytes[255] = 1;
+    }
+    senarena_free(arena);
+  }
+  return NULL;
+}
+#endif
+
 senmac_public
 void run_sensible_arena_suite(struct sentest_state *state) {
   sentest_group(state, "sensible-arena") {
@@ -26,6 +169,16 @@ void run_sensible_arena_suite(struct sentest_state *state) {
       struct senarena arena = senarena_new();
       senarena_free(arena);
     }
+    sentest(state, "can be trimmed") {
+      struct senarena arena = senarena_new();
+      senarena_alloc(&arena, 1024 * 1024, 1);
+      senarena_clear(&arena);
+      sentest_assert_neq(state, arena.fresh_chunks, NULL);
+      senarena_trim(&arena);
+      sentest_assert_eq(state, arena.fresh_chunks, NULL);
+      senarena_alloc(&arena, 1024 * 1024, 1);
+      senarena_free(arena);
+    }
     sentest(state, "can allocate an int") {
       struct senarena arena = senarena_new();
       volatile int *a = senarena_alloc_type(&arena, int);
@@ -89,6 +242,225 @@ void run_sensible_arena_suite(struct sentest_state *state) {
         }
       }
     }
+    sentest_group(state, "with large alignments") {
+      static const size_t alignments[] = {64, 4096, 2 * 1024 * 1024};
+      sentest(state, "aligns every allocation") {
+        for (size_t i = 0; i < STATIC_LEN(alignments); i++) {
+          const size_t alignment = alignments[i];
+          const size_t sizes[] = {1, 100, alignment, alignment + alignment / 2};
+          struct senarena arena = senarena_new();
+          bool aligned = true;
+          for (int round = 0; round < 4; round++) {
+            for (size_t j = 0; j < STATIC_LEN(sizes); j++) {
+              volatile unsigned char *bytes = senarena_alloc(&arena, sizes[j], alignment);
+              aligned = aligned && is_aligned((const void*) bytes, alignment);
+              bytes[0] = 1;
+              bytes[sizes[j] - 1] = 1;
+            }
+          }
+          sentest_assert(state, aligned);
+          senarena_free(arena);
+        }
+      }
+      sentest(state, "zeroes aligned allocations") {
+        for (size_t i = 0; i < STATIC_LEN(alignments); i++) {
+          const size_t alignment = alignments[i];
+          struct senarena arena = senarena_new();
+          memset(senarena_alloc(&arena, 1000, 1), 0xff, 1000);
+          bool zeroed = true;
+          for (int round = 0; round < 4; round++) {
+            unsigned char *bytes = senarena_alloc_zeroed(&arena, alignment, alignment);
+            zeroed = zeroed && is_aligned(bytes, alignment) && all_zero(bytes, alignment);
+            memset(bytes, 0xff, alignment);
+          }
+          sentest_assert(state, zeroed);
+          senarena_free(arena);
+        }
+      }
+      sentest(state, "shares chunks between page-aligned pages") {
+        // chunks may grow to hold 16 pages, unlike senarena_new's
+        struct senarena_config config = { .max_chunk_size = 1024 * 1024 };
+        struct senarena arena = senarena_new_with_config(config);
+        bool aligned_tops = true;
+        for (int i = 0; i < 64; i++) {
+          const uintptr_t bottom = arena.bottom;
+          volatile unsigned char *page = senarena_alloc(&arena, 4096, 4096);
+          page[4095] = 1;
+          // the page went first in a new chunk, at its top
+          if (arena.bottom != bottom) {
+            aligned_tops = aligned_tops && (uintptr_t) page + 4096 == SENARENA_ALIGN_DOWN(arena.bottom + current_chunk(&arena)->capacity, 4096);
+          }
+        }
+        sentest_assert(state, aligned_tops);
+        const size_t chunks = chain_length(current_chunk(&arena));
+        sentest_assert(state, chunks <= 6);
+        senarena_free(arena);
+      }
+      sentest(state, "keeps chunks within max_chunk_size") {
+        struct senarena arena = senarena_new();
+        for (int i = 0; i < 16; i++) {
+          volatile unsigned char *page = senarena_alloc(&arena, 4096, 4096);
+          page[4095] = 1;
+        }
+        // each page got a dedicated chunk, just big enough to align it
+        bool small = true;
+        for (const struct senarena_chunk_header *chunk = current_chunk(&arena); chunk != NULL; chunk = chunk->ptr) {
+          small = small && chunk->capacity < 2 * 4096;
+        }
+        sentest_assert(state, small);
+        sentest_assert_eq_fmt(state, "zu", chain_length(current_chunk(&arena)), (size_t) 17);
+        senarena_free(arena);
+      }
+      sentest(state, "only grows chunks up to max_chunk_size") {
+        // like senarena_new's
+        struct senarena arena = senarena_new();
+        volatile unsigned char *bytes = senarena_alloc(&arena, 1024 * 1024, 2 * 1024 * 1024);
+        bytes[0] = 1;
+        sentest_assert_eq_fmt(state, "zu", arena.max_alignment, (size_t) 1);
+        for (int i = 0; i < 1000; i++) {
+          senarena_alloc(&arena, 32, 8);
+        }
+        bool bounded = true;
+        for (const struct senarena_chunk_header *chunk = current_chunk(&arena); chunk != NULL; chunk = chunk->ptr) {
+          // the dedicated chunk aside
+          bounded = bounded && (chunk->capacity == SENARENA_DEFAULT_CHUNK_SIZE || chunk->capacity > 1024 * 1024);
+        }
+        sentest_assert(state, bounded);
+        senarena_free(arena);
+
+        // room for 16 of them, and to align the top, or not quite
+        const size_t max_chunk_size = 17 * 32 * 1024;
+        struct senarena_config config = { .max_chunk_size = max_chunk_size };
+        arena = senarena_new_with_config(config);
+        senarena_alloc(&arena, 64 * 1024, 64 * 1024);
+        sentest_assert_eq_fmt(state, "zu", arena.max_alignment, (size_t) 1);
+        senarena_alloc(&arena, 32 * 1024, 32 * 1024);
+        sentest_assert_eq_fmt(state, "zu", arena.max_alignment, (size_t) (32 * 1024));
+        for (int i = 0; i < 64; i++) {
+          senarena_alloc(&arena, 32 * 1024, 32 * 1024);
+        }
+        bounded = true;
+        for (const struct senarena_chunk_header *chunk = current_chunk(&arena); chunk != NULL; chunk = chunk->ptr) {
+          bounded = bounded && chunk->capacity <= max_chunk_size;
+        }
+        sentest_assert(state, bounded);
+        senarena_free(arena);
+      }
+      sentest(state, "doesn't grow chunks for small allocations") {
+        struct senarena_config config = { .max_chunk_size = 64 * 1024 * 1024 };
+        struct senarena arena = senarena_new_with_config(config);
+        volatile unsigned char *bytes = senarena_alloc(&arena, 64, 2 * 1024 * 1024);
+        bytes[63] = 1;
+        sentest_assert_eq_fmt(state, "zu", arena.max_alignment, (size_t) 1);
+        for (int i = 0; i < 1000; i++) {
+          senarena_alloc(&arena, 16, 1);
+        }
+        bool small = true;
+        for (const struct senarena_chunk_header *chunk = current_chunk(&arena); chunk != NULL; chunk = chunk->ptr) {
+          small = small && (chunk->capacity == SENARENA_DEFAULT_CHUNK_SIZE || chunk->capacity < 2 * 1024 * 1024 + 4096);
+        }
+        sentest_assert(state, small);
+        senarena_free(arena);
+      }
+      sentest(state, "forgets the alignment when cleared") {
+        struct senarena_config config = { .max_chunk_size = 1024 * 1024 };
+        struct senarena arena = senarena_new_with_config(config);
+        for (int i = 0; i < 32; i++) {
+          senarena_alloc(&arena, 4096, 4096);
+        }
+        sentest_assert_eq_fmt(state, "zu", arena.max_alignment, (size_t) 4096);
+        senarena_clear(&arena);
+        sentest_assert_eq_fmt(state, "zu", arena.max_alignment, (size_t) 1);
+        senarena_trim(&arena);
+        // the cleared arena kept its last chunk; the next one is regular
+        const uintptr_t bottom = arena.bottom;
+        const size_t chunk_size = arena.chunk_size;
+        while (arena.bottom == bottom) {
+          senarena_alloc(&arena, 16, 1);
+        }
+        sentest_assert_eq_fmt(state, "zu", (size_t) current_chunk(&arena)->capacity, chunk_size);
+        senarena_free(arena);
+      }
+      sentest(state, "leaves reusable chunks it can't fit alone") {
+        struct senarena_config config = { .max_chunk_size = 1024 * 1024 };
+        struct senarena arena = senarena_new_with_config(config);
+        for (int i = 0; i < 100; i++) {
+          senarena_alloc(&arena, 1000, 1);
+        }
+        senarena_clear(&arena);
+        const size_t reusable = chain_length(arena.fresh_chunks);
+        senarena_alloc(&arena, 3000, 1);
+        for (int i = 0; i < 4; i++) {
+          volatile unsigned char *bytes = senarena_alloc(&arena, 3000, 4096);
+          bytes[2999] = 1;
+        }
+        // the first one got the current chunk's leftovers, the rest a new chunk
+        sentest_assert_eq_fmt(state, "zu", chain_length(arena.fresh_chunks), reusable);
+        senarena_free(arena);
+      }
+      sentest(state, "reuses chunks that fit, further down") {
+        struct senarena_config config = { .max_chunk_size = 1024 * 1024 };
+        struct senarena arena = senarena_new_with_config(config);
+        size_t chunks[2];
+        for (int cycle = 0; cycle < 2; cycle++) {
+          for (int i = 0; i < 64; i++) {
+            for (int j = 0; j < 16; j++) {
+              senarena_alloc(&arena, 512, 8);
+            }
+            volatile unsigned char *bytes = senarena_alloc(&arena, 3000, 4096);
+            bytes[2999] = 1;
+            // dedicated
+            if (i % 8 == 0) {
+              bytes = senarena_alloc(&arena, 64 * 1024, 4096);
+              bytes[64 * 1024 - 1] = 1;
+            }
+          }
+          senarena_clear(&arena);
+          chunks[cycle] = chain_length(current_chunk(&arena)) + chain_length(arena.fresh_chunks);
+        }
+        sentest_assert_eq_fmt(state, "zu", chunks[1], chunks[0]);
+        senarena_free(arena);
+      }
+      sentest(state, "leaves the current chunk available for a dedicated one") {
+        struct senarena arena = senarena_new();
+        const uintptr_t bottom = arena.bottom;
+        const uintptr_t top = arena.top;
+        // bigger than a quarter of the chunks that hold pages
+        unsigned char *bytes = senarena_alloc(&arena, 64 * 1024, 4096);
+        sentest_assert(state, is_aligned(bytes, 4096));
+        memset(bytes, 1, 64 * 1024);
+        sentest_assert_eq(state, arena.bottom, bottom);
+        sentest_assert_eq(state, arena.top, top);
+        senarena_free(arena);
+      }
+      sentest(state, "aligns allocations in an allocator's chunks") {
+        struct counting_allocator counts = { .outstanding = 0, .remaining = SIZE_MAX };
+        struct senarena arena = new_counting_arena(&counts);
+        bool aligned = true;
+        for (int i = 0; i < 32; i++) {
+          const size_t alignment = alignments[i % STATIC_LEN(alignments)];
+          volatile unsigned char *bytes = senarena_alloc(&arena, 64, alignment);
+          aligned = aligned && is_aligned((const void*) bytes, alignment);
+          bytes[63] = 1;
+        }
+        sentest_assert(state, aligned);
+        senarena_free(arena);
+        sentest_assert_eq_fmt(state, "zu", counts.outstanding, (size_t) 0);
+      }
+      sentest(state, "aligns allocations with the mmap backend") {
+        struct senarena_config config = { .backend = SENARENA_BACKEND_MMAP };
+        struct senarena arena = senarena_new_with_config(config);
+        bool aligned = true;
+        for (int i = 0; i < 32; i++) {
+          const size_t alignment = alignments[i % STATIC_LEN(alignments)];
+          volatile unsigned char *bytes = senarena_alloc(&arena, alignment, alignment);
+          aligned = aligned && is_aligned((const void*) bytes, alignment);
+          bytes[alignment - 1] = 1;
+        }
+        sentest_assert(state, aligned);
+        senarena_free(arena);
+      }
+    }
     sentest_group(state, "when clearing an arena") {
       sentest(state, "reuses the chunk chain") {
         struct senarena arena = senarena_new();
@@ -106,7 +478,1392 @@ void run_sensible_arena_suite(struct sentest_state *state) {
         sentest_assert_eq_fmt(state, "p", (unsigned char*) arena.fresh_chunks + sizeof(struct senarena_chunk_header), area);
         senarena_free(arena);
       }
+      sentest(state, "keeps every chunk when cleared repeatedly") {
+        struct senarena arena = senarena_new();
+        for (int i = 0; i < 40; i++) {
+          senarena_alloc(&arena, 1000, 1);
+        }
+        senarena_alloc(&arena, SENARENA_DEFAULT_CHUNK_SIZE, 1);
+        const size_t chunks = chain_length(current_chunk(&arena));
+        senarena_clear(&arena);
+        for (int round = 0; round < 3; round++) {
+          for (int i = 0; i < 10 * round; i++) {
+            senarena_alloc(&arena, 1000, 1);
+          }
+          senarena_clear(&arena);
+          sentest_assert_eq_fmt(state, "zu", chain_length(current_chunk(&arena)), (size_t) 1);
+          sentest_assert_eq(state, arena.oldest, current_chunk(&arena));
+          sentest_assert_eq_fmt(state, "zu", chain_length(arena.fresh_chunks), chunks - 1);
+        }
+        senarena_free(arena);
+      }
+    }
+    sentest_group(state, "when rewinding to a mark") {
+      sentest(state, "restores the top of the arena") {
+        struct senarena arena = senarena_new();
+        senarena_alloc_type(&arena, int);
+        const struct senarena_mark mark = senarena_mark(&arena);
+        senarena_alloc(&arena, 100, 8);
+        senarena_rewind(&arena, mark);
+        sentest_assert_eq(state, arena.top, mark.top);
+        sentest_assert_eq(state, arena.bottom, mark.bottom);
+        senarena_free(arena);
+      }
+      sentest(state, "reuses chunks acquired after the mark") {
+        struct senarena arena = senarena_new();
+        senarena_alloc_type(&arena, int);
+        const struct senarena_mark mark = senarena_mark(&arena);
+        for (int i = 0; i < 1000; i++) {
+          senarena_alloc(&arena, 100, 1);
+        }
+        const size_t chunks = chain_length(current_chunk(&arena));
+        senarena_rewind(&arena, mark);
+        sentest_assert_eq(state, arena.bottom, mark.bottom);
+        sentest_assert_eq_fmt(state, "zu", chain_length(current_chunk(&arena)), (size_t) 1);
+        sentest_assert_eq_fmt(state, "zu", chain_length(arena.fresh_chunks), chunks - 1);
+        for (int i = 0; i < 1000; i++) {
+          senarena_alloc(&arena, 100, 1);
+        }
+        sentest_assert_eq_fmt(state, "zu", chain_length(current_chunk(&arena)), chunks);
+        sentest_assert_eq(state, arena.fresh_chunks, NULL);
+        senarena_free(arena);
+      }
+      sentest(state, "releases dedicated chunks allocated after the mark") {
+        struct senarena arena = senarena_new();
+        for (int i = 0; i < 100; i++) {
+          senarena_alloc(&arena, 100, 1);
+        }
+        const size_t chunks = chain_length(current_chunk(&arena));
+        const struct senarena_mark mark = senarena_mark(&arena);
+        senarena_alloc(&arena, 1024 * 1024, 1);
+        for (int i = 0; i < 100; i++) {
+          senarena_alloc(&arena, 100, 1);
+        }
+        senarena_alloc(&arena, 1024 * 1024, 1);
+        const size_t total_chunks = chain_length(current_chunk(&arena));
+        senarena_rewind(&arena, mark);
+        sentest_assert_eq_fmt(state, "zu", chain_length(current_chunk(&arena)), chunks);
+        sentest_assert_eq_fmt(state, "zu", chain_length(arena.fresh_chunks), total_chunks - chunks);
+        senarena_free(arena);
+      }
+      sentest(state, "releases dedicated chunks behind the first chunk") {
+        struct senarena arena = senarena_new();
+        const struct senarena_mark mark = senarena_mark(&arena);
+        senarena_alloc(&arena, 1024 * 1024, 1);
+        senarena_alloc(&arena, 1024 * 1024, 1);
+        senarena_rewind(&arena, mark);
+        sentest_assert_eq_fmt(state, "zu", chain_length(current_chunk(&arena)), (size_t) 1);
+        sentest_assert_eq_fmt(state, "zu", chain_length(arena.fresh_chunks), (size_t) 2);
+        senarena_free(arena);
+      }
+      sentest(state, "can rewind nested marks") {
+        struct senarena arena = senarena_new();
+        const struct senarena_mark outer = senarena_mark(&arena);
+        for (int i = 0; i < 100; i++) {
+          senarena_alloc(&arena, 100, 1);
+        }
+        const struct senarena_mark inner = senarena_mark(&arena);
+        for (int i = 0; i < 100; i++) {
+          senarena_alloc(&arena, 100, 1);
+        }
+        senarena_rewind(&arena, inner);
+        sentest_assert_eq(state, arena.top, inner.top);
+        for (int i = 0; i < 100; i++) {
+          senarena_alloc(&arena, 100, 1);
+        }
+        senarena_rewind(&arena, outer);
+        sentest_assert_eq(state, arena.top, outer.top);
+        sentest_assert_eq(state, arena.bottom, outer.bottom);
+        sentest_assert_eq_fmt(state, "zu", chain_length(current_chunk(&arena)), (size_t) 1);
+        senarena_free(arena);
+      }
+    }
+    sentest_group(state, "when resizing the last allocation") {
+      sentest(state, "grows it in place") {
+        struct senarena arena = senarena_new();
+        unsigned char *a = senarena_alloc(&arena, 16, 1);
+        memset(a, 42, 16);
+        unsigned char *b = senarena_realloc_last(&arena, a, 16, 48, 1);
+        sentest_assert_eq_fmt(state, "p", (void*) b, (void*) (a - 32));
+        sentest_assert_eq(state, (uintptr_t) b, arena.top);
+        sentest_assert_eq(state, b[0], 42);
+        sentest_assert_eq(state, b[15], 42);
+        senarena_free(arena);
+      }
+      sentest(state, "shrinks it in place") {
+        struct senarena arena = senarena_new();
+        const uintptr_t initial_top = arena.top;
+        unsigned char *a = senarena_alloc(&arena, 64, 1);
+        memset(a, 42, 64);
+        unsigned char *b = senarena_realloc_last(&arena, a, 64, 16, 1);
+        sentest_assert_eq(state, (uintptr_t) b, initial_top - 16);
+        sentest_assert_eq(state, b[0], 42);
+        sentest_assert_eq(state, b[15], 42);
+        senarena_free(arena);
+      }
+      sentest(state, "copies it if it isn't the last allocation") {
+        struct senarena arena = senarena_new();
+        unsigned char *a = senarena_alloc(&arena, 16, 1);
+        memset(a, 42, 16);
+        senarena_alloc_type(&arena, int);
+        unsigned char *b = senarena_realloc_last(&arena, a, 16, 32, 1);
+        sentest_assert_neq(state, a, b);
+        sentest_assert_eq(state, b[15], 42);
+        senarena_free(arena);
+      }
+      sentest(state, "copies it when the chunk is full") {
+        struct senarena arena = senarena_new();
+        const size_t size = 512;
+        unsigned char *a = senarena_alloc(&arena, size, 8);
+        memset(a, 42, size);
+        for (size_t new_size = size * 2; new_size < SENARENA_DEFAULT_CHUNK_SIZE * 4; new_size *= 2) {
+          a = senarena_realloc_last(&arena, a, new_size / 2, new_size, 8);
+          sentest_assert_eq(state, (uintptr_t) a % 8, 0);
+        }
+        sentest_assert_eq(state, a[0], 42);
+        sentest_assert_eq(state, a[size - 1], 42);
+        senarena_free(arena);
+      }
+    }
+    sentest_group(state, "growable buffers") {
+      sentest(state, "keep their contents as they grow") {
+        struct senarena arena = senarena_new();
+        struct senarena_buf buf = senarena_buf_new(&arena, SENARENA_ALIGNOF(int));
+        for (int i = 0; i < 10000; i++) {
+          senarena_buf_append(&buf, &i, sizeof(int));
+        }
+        const int *ints = senarena_buf_finish(&buf);
+        sentest_assert_eq_fmt(state, "zu", buf.length, 10000 * sizeof(int));
+        bool equal = true;
+        for (int i = 0; i < 10000; i++) {
+          equal &= ints[i] == i;
+        }
+        sentest_assert(state, equal);
+        senarena_free(arena);
+      }
+      sentest(state, "grow in place within a chunk") {
+        struct senarena arena = senarena_new();
+        const uintptr_t bottom = arena.bottom;
+        struct senarena_buf buf = senarena_buf_new(&arena, 1);
+        for (int i = 0; i < 1000; i++) {
+          *(char*) senarena_buf_reserve(&buf, 1) = 'a';
+        }
+        senarena_buf_finish(&buf);
+        sentest_assert_eq(state, arena.bottom, bottom);
+        sentest_assert_eq_fmt(state, "zu", (size_t) (bottom + SENARENA_DEFAULT_CHUNK_SIZE - arena.top), (size_t) 1000);
+        senarena_free(arena);
+      }
+    }
+    sentest_group(state, "with geometric chunk growth") {
+      struct senarena_config config = {
+        .backend = SENARENA_BACKEND_MALLOC,
+        .huge_pages = false,
+        .chunk_size = SENARENA_DEFAULT_CHUNK_SIZE,
+        .growth_factor = 2,
+        .max_chunk_size = 1024 * 1024 - sizeof(struct senarena_chunk_header),
+      };
+      sentest(state, "doubles each new chunk, up to the cap") {
+        struct senarena arena = senarena_new_with_config(config);
+        size_t expected_total = SENARENA_DEFAULT_CHUNK_SIZE + sizeof(struct senarena_chunk_header);
+        for (int i = 0; i < 10; i++) {
+          const struct senarena_chunk_header *header = (struct senarena_chunk_header*) (arena.bottom - sizeof(struct senarena_chunk_header));
+          sentest_assert_eq_fmt(state, "zu", (size_t) header->capacity + sizeof(struct senarena_chunk_header), expected_total);
+          const uintptr_t bottom = arena.bottom;
+          while (arena.bottom == bottom) {
+            senarena_alloc(&arena, 100, 1);
+          }
+          expected_total = SENARENA_MIN(expected_total * 2, (size_t) 1024 * 1024);
+        }
+        senarena_free(arena);
+      }
+      sentest(state, "allocates relatively small objects in the current chunk") {
+        struct senarena arena = senarena_new_with_config(config);
+        // grow to 64KiB chunks
+        for (int i = 0; i < 5; i++) {
+          const uintptr_t bottom = arena.bottom;
+          while (arena.bottom == bottom) {
+            senarena_alloc(&arena, 100, 1);
+          }
+        }
+        const uintptr_t bottom = arena.bottom;
+        volatile unsigned char *area = senarena_alloc(&arena, 8 * 1024, 1);
+        sentest_assert_eq(state, arena.bottom, bottom);
+        sentest_assert_eq(state, (uintptr_t) area, arena.top);
+        senarena_free(arena);
+      }
+      sentest(state, "uses few chunks for big arenas") {
+        struct senarena_config big_config = config;
+        big_config.max_chunk_size = SENARENA_DEFAULT_MAX_CHUNK_SIZE;
+        struct senarena arena = senarena_new_with_config(big_config);
+        for (int i = 0; i < 1024 * 1024; i++) {
+          senarena_alloc(&arena, 128, 8);
+        }
+        size_t chunks = 0;
+        for (struct senarena_chunk_header *header = (struct senarena_chunk_header*) (arena.bottom - sizeof(struct senarena_chunk_header)); header != NULL; header = header->ptr) {
+          chunks++;
+        }
+        sentest_assert(state, chunks < 20);
+        senarena_free(arena);
+      }
+    }
+    sentest_group(state, "with the mmap backend") {
+      struct senarena_config config = {
+        .backend = SENARENA_BACKEND_MMAP,
+        .huge_pages = false,
+      };
+      sentest(state, "can allocate more than a chunk's worth of data in steps") {
+        struct senarena arena = senarena_new_with_config(config);
+        for (int i = 0; i < 10000; i++) {
+          volatile unsigned char *area = senarena_alloc(&arena, 100, 1);
+          memset((void*) area, 50, 100);
+        }
+        senarena_free(arena);
+      }
+      sentest(state, "carves consecutive chunks out of a region") {
+        struct senarena arena = senarena_new_with_config(config);
+        const uintptr_t first = arena.bottom;
+        while (arena.bottom == first) {
+          senarena_alloc(&arena, 100, 1);
+        }
+        sentest_assert_eq_fmt(state, "p", (void*) arena.bottom, (void*) (first + SENARENA_DEFAULT_CHUNK_SIZE + sizeof(struct senarena_chunk_header)));
+        senarena_free(arena);
+      }
+      sentest(state, "can use huge pages") {
+        struct senarena_config huge_config = config;
+        huge_config.huge_pages = true;
+        struct senarena arena = senarena_new_with_config(huge_config);
+        const size_t size = 4 * 1024 * 1024;
+        volatile unsigned char *area = senarena_alloc(&arena, size, 1);
+        memset((void*) area, 1, size);
+        sentest_assert_eq(state, area[size - 1], 1);
+        senarena_free(arena);
+      }
+      sentest(state, "keeps trimmed chunks usable") {
+        struct senarena arena = senarena_new_with_config(config);
+        const size_t size = 1024 * 1024;
+        volatile unsigned char *area = senarena_alloc(&arena, size, 1);
+        memset((void*) area, 0xff, size);
+        senarena_clear(&arena);
+        senarena_trim(&arena);
+#ifdef __linux__
+        // MADV_DONTNEED gives us zero pages on Linux
+        sentest_assert_eq(state, area[size / 2], 0);
+#endif
+        for (int i = 0; i < 10000; i++) {
+          volatile unsigned char *small = senarena_alloc(&arena, 100, 1);
+          memset((void*) small, 50, 100);
+        }
+        senarena_free(arena);
+      }
+    }
+    sentest_group(state, "over a caller's buffer") {
+      sentest(state, "allocates from the buffer") {
+        uint64_t buffer[128];
+        const uintptr_t start = (uintptr_t) buffer;
+        struct senarena arena = senarena_new_with_buffer(buffer, sizeof(buffer));
+        for (int i = 0; i < 10; i++) {
+          const uintptr_t ptr = (uintptr_t) senarena_alloc(&arena, 50, 1);
+          sentest_assert(state, ptr >= start && ptr + 50 <= start + sizeof(buffer));
+        }
+        senarena_free(arena);
+      }
+      sentest(state, "moves to the heap when it overflows") {
+        uint64_t buffer[128];
+        struct senarena arena = senarena_new_with_buffer(buffer, sizeof(buffer));
+        for (int i = 0; i < 100; i++) {
+          volatile unsigned char *bytes = senarena_alloc(&arena, 100, 1);
+          memset((void*) bytes, 42, 100);
+        }
+        sentest_assert(state, chain_length(current_chunk(&arena)) > 1);
+        senarena_free(arena);
+      }
+      sentest(state, "keeps the buffer when cleared and trimmed") {
+        uint64_t buffer[128];
+        struct senarena arena = senarena_new_with_buffer(buffer, sizeof(buffer));
+        for (int i = 0; i < 100; i++) {
+          senarena_alloc(&arena, 100, 1);
+        }
+        senarena_clear(&arena);
+        senarena_trim(&arena);
+        sentest_assert_eq(state, arena.fresh_chunks, arena.buffer);
+        sentest_assert_eq_fmt(state, "zu", chain_length(arena.fresh_chunks), (size_t) 1);
+        // fill the heap chunk that was current when we cleared
+        for (int i = 0; i < 4; i++) {
+          senarena_alloc(&arena, 1000, 1);
+        }
+        senarena_alloc(&arena, 500, 1);
+        sentest_assert_eq(state, current_chunk(&arena), arena.buffer);
+        senarena_free(arena);
+      }
+      sentest(state, "never gives the buffer to the chunk pool") {
+        const size_t chunk_bytes = SENARENA_DEFAULT_CHUNK_SIZE + sizeof(struct senarena_chunk_header);
+        uint64_t buffer[(SENARENA_DEFAULT_CHUNK_SIZE + sizeof(struct senarena_chunk_header)) / sizeof(uint64_t)];
+        senarena_pool_set_capacity(chunk_bytes * 16);
+        struct senarena arena = senarena_new_with_buffer(buffer, sizeof(buffer));
+        sentest_assert_eq_fmt(state, "zu", current_chunk(&arena)->capacity, (size_t) SENARENA_DEFAULT_CHUNK_SIZE);
+        for (int i = 0; i < 100; i++) {
+          senarena_alloc(&arena, 100, 1);
+        }
+        const size_t heap_chunks = chain_length(current_chunk(&arena)) - 1;
+        senarena_free(arena);
+        sentest_assert_eq_fmt(state, "zu", senarena_pool_stats().retained_bytes, heap_chunks * chunk_bytes);
+        senarena_pool_set_capacity(0);
+      }
+      sentest(state, "ignores buffers too small for a chunk") {
+        uint64_t buffer[1];
+        struct senarena arena = senarena_new_with_buffer(buffer, sizeof(buffer));
+        sentest_assert_eq(state, arena.buffer, NULL);
+        senarena_alloc(&arena, 100, 1);
+        senarena_free(arena);
+      }
+    }
+    sentest_group(state, "with an allocator") {
+      sentest(state, "gets and frees every chunk through it") {
+        struct counting_allocator counts = { .outstanding = 0, .remaining = SIZE_MAX };
+        struct senarena arena = new_counting_arena(&counts);
+        for (int i = 0; i < 100; i++) {
+          senarena_alloc(&arena, 100, 1);
+        }
+        senarena_alloc(&arena, 100000, 1);
+        sentest_assert_eq_fmt(state, "zu", counts.outstanding, chain_length(current_chunk(&arena)));
+        senarena_clear(&arena);
+        senarena_trim(&arena);
+        sentest_assert_eq_fmt(state, "zu", counts.outstanding, (size_t) 1);
+        senarena_free(arena);
+        sentest_assert_eq_fmt(state, "zu", counts.outstanding, (size_t) 0);
+      }
+      sentest(state, "never gives its chunks to the chunk pool") {
+        struct counting_allocator counts = { .outstanding = 0, .remaining = SIZE_MAX };
+        senarena_pool_set_capacity(1024 * 1024);
+        struct senarena arena = new_counting_arena(&counts);
+        for (int i = 0; i < 100; i++) {
+          senarena_alloc(&arena, 100, 1);
+        }
+        senarena_free(arena);
+        sentest_assert_eq_fmt(state, "zu", counts.outstanding, (size_t) 0);
+        sentest_assert_eq_fmt(state, "zu", senarena_pool_stats().retained_bytes, (size_t) 0);
+        senarena_pool_set_capacity(0);
+      }
+      sentest(state, "returns NULL when it fails") {
+        struct counting_allocator counts = { .outstanding = 0, .remaining = 1 };
+        struct senarena arena = new_counting_arena(&counts);
+        unsigned char *last = NULL;
+        unsigned char *res;
+        while ((res = senarena_alloc(&arena, 100, 1)) != NULL) {
+          last = res;
+        }
+        sentest_assert_neq(state, last, NULL);
+        sentest_assert_eq(state, senarena_alloc(&arena, 100000, 1), NULL);
+        // the arena is still usable once the allocator recovers
+        counts.remaining = 1;
+        sentest_assert_neq(state, senarena_alloc(&arena, 100, 1), NULL);
+        senarena_free(arena);
+        sentest_assert_eq_fmt(state, "zu", counts.outstanding, (size_t) 0);
+      }
+      sentest(state, "leaves the last allocation alone when resizing fails") {
+        struct counting_allocator counts = { .outstanding = 0, .remaining = 1 };
+        struct senarena arena = new_counting_arena(&counts);
+        struct senarena_buf buf = senarena_buf_new(&arena, 1);
+        sentest_assert(state, senarena_buf_append(&buf, "abc", 3));
+        unsigned char *data = buf.data;
+        static const unsigned char big[SENARENA_DEFAULT_CHUNK_SIZE];
+        sentest_assert(state, !senarena_buf_append(&buf, big, sizeof(big)));
+        sentest_assert_eq(state, buf.data, data);
+        sentest_assert_eq_fmt(state, "zu", buf.length, (size_t) 3);
+        sentest_assert(state, memcmp(senarena_buf_finish(&buf), "abc", 3) == 0);
+        senarena_free(arena);
+      }
+      sentest(state, "reports a failed first chunk") {
+        struct counting_allocator counts = { .outstanding = 0, .remaining = 0 };
+        struct senarena arena = new_counting_arena(&counts);
+        sentest_assert_eq(state, arena.bottom, 0);
+        senarena_free(arena);
+      }
+      sentest(state, "recovers from a failed first chunk") {
+        struct counting_allocator counts = { .outstanding = 0, .remaining = 0 };
+        struct senarena arena = new_counting_arena(&counts);
+        sentest_assert_eq(state, senarena_alloc(&arena, 100000, 1), NULL);
+        sentest_assert_eq(state, senarena_alloc(&arena, 100, 1), NULL);
+        sentest_assert_eq(state, senarena_alloc_zeroed(&arena, 100, 1), NULL);
+        sentest_assert(state, !senarena_reserve(&arena, 100));
+        const struct senarena_mark empty = senarena_mark(&arena);
+        senarena_rewind(&arena, empty);
+        senarena_clear(&arena);
+        sentest_assert_eq(state, arena.bottom, 0);
+        counts.remaining = SIZE_MAX;
+        volatile unsigned char *small = senarena_alloc(&arena, 100, 1);
+        sentest_assert_neq(state, small, NULL);
+        small[99] = 1;
+        const struct senarena_mark mark = senarena_mark(&arena);
+        volatile unsigned char *large = senarena_alloc(&arena, 100000, 1);
+        sentest_assert_neq(state, large, NULL);
+        large[99999] = 1;
+        senarena_rewind(&arena, mark);
+        senarena_rewind(&arena, empty);
+        sentest_assert_eq(state, arena.top, arena.bottom + SENARENA_DEFAULT_CHUNK_SIZE);
+        senarena_clear(&arena);
+        senarena_free(arena);
+        sentest_assert_eq_fmt(state, "zu", counts.outstanding, (size_t) 0);
+      }
+      sentest(state, "can take chunks from a parent arena") {
+        struct senarena parent = senarena_new();
+        struct senarena_config config = { .allocator = senarena_parent_allocator(&parent) };
+        struct senarena child = senarena_new_with_config(config);
+        for (int i = 0; i < 100; i++) {
+          volatile unsigned char *bytes = senarena_alloc(&child, 100, 1);
+          memset((void*) bytes, 42, 100);
+        }
+        senarena_alloc(&child, 100000, 1);
+        senarena_clear(&child);
+        senarena_trim(&child);
+        sentest_assert_neq(state, child.fresh_chunks, NULL);
+        senarena_free(child);
+        senarena_free(parent);
+      }
+    }
+    sentest_group(state, "the shared chunk pool") {
+      const size_t chunk_bytes = SENARENA_DEFAULT_CHUNK_SIZE + sizeof(struct senarena_chunk_header);
+      sentest(state, "is disabled by default") {
+        struct senarena arena = senarena_new();
+        senarena_free(arena);
+        sentest_assert_eq_fmt(state, "zu", senarena_pool_stats().retained_bytes, (size_t) 0);
+      }
+      sentest(state, "reuses chunks freed by other arenas") {
+        senarena_pool_set_capacity(chunk_bytes * 16);
+        struct senarena a = senarena_new();
+        const uintptr_t chunk = a.bottom;
+        senarena_free(a);
+        sentest_assert_eq_fmt(state, "zu", senarena_pool_stats().retained_bytes, chunk_bytes);
+        const uint64_t hits = senarena_pool_stats().hits;
+        struct senarena b = senarena_new();
+        sentest_assert_eq_fmt(state, "p", (void*) b.bottom, (void*) chunk);
+        sentest_assert_eq(state, senarena_pool_stats().hits, hits + 1);
+        senarena_free(b);
+        senarena_pool_set_capacity(0);
+        sentest_assert_eq_fmt(state, "zu", senarena_pool_stats().retained_bytes, (size_t) 0);
+      }
+      sentest(state, "retains at most its capacity") {
+        senarena_pool_set_capacity(chunk_bytes * 4);
+        struct senarena arena = senarena_new();
+        for (int i = 0; i < 10000; i++) {
+          senarena_alloc(&arena, 100, 1);
+        }
+        senarena_free(arena);
+        sentest_assert_eq_fmt(state, "zu", senarena_pool_stats().retained_bytes, chunk_bytes * 4);
+        senarena_pool_set_capacity(0);
+      }
+#ifndef _WIN32
+      sentest(state, "is shared by threads while its capacity changes") {
+        pthread_t threads[4];
+        senarena_pool_set_capacity(chunk_bytes * 64);
+        for (int i = 0; i < 4; i++) {
+          pthread_create(&threads[i], NULL, churn_pooled_arenas, NULL);
+        }
+        // chunks that leave the pool are freed while others take theirs
+        for (int i = 0; i < 200; i++) {
+          senarena_pool_set_capacity(i % 2 == 0 ? chunk_bytes * 8 : chunk_bytes * 64);
+        }
+        for (int i = 0; i < 4; i++) {
+          pthread_join(threads[i], NULL);
+        }
+        senarena_pool_set_capacity(0);
+        sentest_assert_eq_fmt(state, "zu", senarena_pool_stats().retained_bytes, (size_t) 0);
+      }
+#endif
+    }
+    sentest_group(state, "thread-local arenas") {
+      sentest(state, "are the same on the same thread") {
+        struct senarena *a = senarena_thread_local();
+        struct senarena *b = senarena_thread_local();
+        sentest_assert_eq(state, a, b);
+        senarena_thread_local_free();
+      }
+      sentest(state, "are cleared when the outermost scope ends") {
+        struct senarena *arena = senarena_thread_local();
+        const uintptr_t initial_top = arena->top;
+        sentest_assert_eq(state, senarena_scope_begin(), arena);
+        senarena_alloc_type(arena, int);
+        sentest_assert_eq(state, senarena_scope_begin(), arena);
+        senarena_alloc_type(arena, int);
+        senarena_scope_end();
+        sentest_assert(state, arena->top < initial_top);
+        senarena_scope_end();
+        sentest_assert_eq_fmt(state, "p", (void*) arena->top, (void*) initial_top);
+        senarena_thread_local_free();
+      }
+      sentest(state, "free their allocations when they end") {
+        struct senarena *arena = senarena_scope_begin();
+        senarena_alloc_type(arena, int);
+        const uintptr_t outer_top = arena->top;
+        senarena_scope_begin();
+        for (int i = 0; i < 100; i++) {
+          senarena_alloc(arena, 100, 1);
+        }
+        senarena_scope_end();
+        sentest_assert_eq_fmt(state, "p", (void*) arena->top, (void*) outer_top);
+        senarena_scope_end();
+        senarena_thread_local_free();
+      }
+      sentest(state, "don't begin a scope without room for it") {
+        senarena_thread_local_free();
+        struct counting_allocator counts = { .outstanding = 0, .remaining = 1 };
+        struct senarena_config config = {
+          .allocator = { .alloc = counting_alloc, .free = counting_free, .context = &counts },
+        };
+        senarena_thread_local_set_config(config);
+        struct senarena *arena = senarena_scope_begin();
+        sentest_assert(state, arena != NULL);
+        while (senarena_alloc(arena, 1, 1) != NULL) {}
+        const struct senarena *inner = senarena_scope_begin();
+        sentest_assert_eq(state, inner, NULL);
+        // still in the outer scope
+        sentest_assert_eq(state, senarena_scope_arena(), arena);
+        senarena_scope_end();
+        sentest_assert_eq(state, senarena_scope_arena(), NULL);
+        senarena_thread_local_free();
+        sentest_assert_eq_fmt(state, "zu", counts.outstanding, (size_t) 0);
+        const struct senarena_config default_config = {0};
+        senarena_thread_local_set_config(default_config);
+      }
+#ifndef _WIN32
+      sentest(state, "are different on different threads") {
+        pthread_t thread;
+        void *different = NULL;
+        struct senarena *arena = senarena_thread_local();
+        pthread_create(&thread, NULL, compare_thread_local_arena, arena);
+        pthread_join(thread, &different);
+        sentest_assert_neq(state, different, NULL);
+        senarena_thread_local_free();
+      }
+#endif
+    }
+    sentest_group(state, "batch allocations") {
+      sentest(state, "allocate every object, aligned and apart") {
+        struct senarena arena = senarena_new();
+        // enough to spill over a few chunks
+        const size_t count = 3 * SENARENA_DEFAULT_CHUNK_SIZE / 24;
+        void **ptrs = malloc(sizeof(void*) * count);
+        sentest_assert_eq(state, senarena_alloc_batch(&arena, 20, 8, count, ptrs), count);
+        sentest_assert(state, chain_length(current_chunk(&arena)) > 1);
+        bool aligned = true;
+        for (size_t i = 0; i < count; i++) {
+          aligned = aligned && (uintptr_t) ptrs[i] % 8 == 0;
+          memset(ptrs[i], (int) (i & 0xff), 20);
+        }
+        sentest_assert(state, aligned);
+        bool intact = true;
+        for (size_t i = 0; i < count; i++) {
+          const unsigned char *bytes = ptrs[i];
+          intact = intact && bytes[0] == (i & 0xff) && bytes[19] == (i & 0xff);
+        }
+        sentest_assert(state, intact);
+        free(ptrs);
+        senarena_free(arena);
+      }
+      sentest(state, "are contiguous within a chunk") {
+        struct senarena arena = senarena_new();
+        void *ptrs[10];
+        senarena_alloc_batch(&arena, 12, 8, 10, ptrs);
+        for (int i = 1; i < 10; i++) {
+          sentest_assert_eq(state, (unsigned char*) ptrs[i - 1] + 16, ptrs[i]);
+        }
+        senarena_free(arena);
+      }
+      sentest(state, "allocate large objects") {
+        struct senarena arena = senarena_new();
+        void *ptrs[3];
+        sentest_assert_eq(state, senarena_alloc_batch(&arena, SENARENA_DEFAULT_CHUNK_SIZE, 16, 3, ptrs), 3);
+        for (int i = 0; i < 3; i++) {
+          memset(ptrs[i], i, SENARENA_DEFAULT_CHUNK_SIZE);
+        }
+        senarena_free(arena);
+      }
+      sentest(state, "stop when the allocator fails") {
+        struct counting_allocator counts = { .outstanding = 0, .remaining = 2 };
+        struct senarena arena = new_counting_arena(&counts);
+        const size_t count = 4 * SENARENA_DEFAULT_CHUNK_SIZE / 64;
+        void **ptrs = malloc(sizeof(void*) * count);
+        const size_t done = senarena_alloc_batch(&arena, 64, 8, count, ptrs);
+        sentest_assert(state, done > 0);
+        sentest_assert(state, done < count);
+        free(ptrs);
+        senarena_free(arena);
+      }
+      sentest(state, "can be contiguous") {
+        struct senarena arena = senarena_new();
+        unsigned char *objects = senarena_alloc_contiguous(&arena, 12, 16, 10);
+        sentest_assert_eq(state, (uintptr_t) objects % 16, 0);
+        memset(objects, 1, 160);
+        senarena_free(arena);
+      }
+      sentest(state, "reject contiguous sizes that overflow") {
+        struct senarena arena = senarena_new();
+        sentest_assert_eq(state, senarena_alloc_contiguous(&arena, SIZE_MAX / 2, 1, 3), NULL);
+        senarena_free(arena);
+      }
+    }
+    sentest_group(state, "reserving") {
+      sentest(state, "keeps the current chunk if it has room") {
+        struct senarena arena = senarena_new();
+        const uintptr_t bottom = arena.bottom;
+        sentest_assert(state, senarena_reserve(&arena, 100));
+        sentest_assert_eq_fmt(state, "p", (void*) arena.bottom, (void*) bottom);
+        senarena_free(arena);
+      }
+      sentest(state, "makes room for the whole amount") {
+        struct senarena arena = senarena_new();
+        senarena_alloc(&arena, 100, 1);
+        const size_t amount = 5 * SENARENA_DEFAULT_CHUNK_SIZE;
+        sentest_assert(state, senarena_reserve(&arena, amount));
+        sentest_assert(state, arena.top - arena.bottom >= amount);
+        const uintptr_t bottom = arena.bottom;
+        for (int i = 0; i < 5; i++) {
+          memset(senarena_alloc(&arena, SENARENA_DEFAULT_CHUNK_SIZE, 1), i, SENARENA_DEFAULT_CHUNK_SIZE);
+        }
+        sentest_assert_eq_fmt(state, "p", (void*) arena.bottom, (void*) bottom);
+        sentest_assert_eq(state, chain_length(current_chunk(&arena)), 2);
+        senarena_free(arena);
+      }
+      sentest(state, "reuses a reusable chunk that's big enough") {
+        struct senarena arena = senarena_new();
+        senarena_alloc(&arena, 100, 1);
+        senarena_reserve(&arena, 2 * SENARENA_DEFAULT_CHUNK_SIZE);
+        const uintptr_t big = arena.bottom;
+        while (arena.bottom == big) {
+          senarena_alloc(&arena, 512, 1);
+        }
+        senarena_clear(&arena);
+        sentest_assert(state, arena.bottom != big);
+        sentest_assert(state, senarena_reserve(&arena, 2 * SENARENA_DEFAULT_CHUNK_SIZE));
+        sentest_assert_eq_fmt(state, "p", (void*) arena.bottom, (void*) big);
+        senarena_free(arena);
+      }
+      sentest(state, "is undone by rewinding") {
+        struct senarena arena = senarena_new();
+        const struct senarena_mark mark = senarena_mark(&arena);
+        const uintptr_t top = arena.top;
+        senarena_reserve(&arena, 2 * SENARENA_DEFAULT_CHUNK_SIZE);
+        senarena_rewind(&arena, mark);
+        sentest_assert_eq_fmt(state, "p", (void*) arena.top, (void*) top);
+        sentest_assert_eq(state, chain_length(current_chunk(&arena)), 1);
+        senarena_free(arena);
+      }
+      sentest(state, "returns false when the allocator fails") {
+        struct counting_allocator counts = { .outstanding = 0, .remaining = 1 };
+        struct senarena arena = new_counting_arena(&counts);
+        const uintptr_t top = arena.top;
+        sentest_assert(state, !senarena_reserve(&arena, 2 * SENARENA_DEFAULT_CHUNK_SIZE));
+        sentest_assert_eq_fmt(state, "p", (void*) arena.top, (void*) top);
+        senarena_free(arena);
+        sentest_assert_eq(state, counts.outstanding, 0);
+      }
+    }
+    sentest_group(state, "zeroed allocations") {
+      struct senarena_config mmap_config = {
+        .backend = SENARENA_BACKEND_MMAP,
+        .huge_pages = false,
+      };
+      sentest(state, "are zero in reused chunks") {
+        struct senarena arena = senarena_new();
+        for (int i = 0; i < 100; i++) {
+          memset(senarena_alloc(&arena, 200, 8), 0xff, 200);
+        }
+        senarena_clear(&arena);
+        bool zero = true;
+        for (int i = 0; i < 100; i++) {
+          zero = zero && all_zero(senarena_alloc_zeroed(&arena, 200, 8), 200);
+        }
+        sentest_assert(state, zero);
+        senarena_free(arena);
+      }
+      sentest(state, "know that fresh mmap pages are zero") {
+        struct senarena arena = senarena_new_with_config(mmap_config);
+        sentest_assert_eq_fmt(state, "p", (void*) arena.zeroed, (void*) arena.top);
+        unsigned char *bytes = senarena_alloc_zeroed(&arena, 100, 1);
+        sentest_assert(state, all_zero(bytes, 100));
+        memset(bytes, 0xff, 100);
+        senarena_clear(&arena);
+        sentest_assert(state, arena.zeroed <= (uintptr_t) bytes);
+        sentest_assert(state, all_zero(senarena_alloc_zeroed(&arena, 100, 1), 100));
+        senarena_free(arena);
+      }
+      sentest(state, "are zero after shrinking the last allocation") {
+        struct senarena arena = senarena_new_with_config(mmap_config);
+        unsigned char *bytes = senarena_alloc(&arena, 100, 1);
+        memset(bytes, 0xff, 100);
+        senarena_realloc_last(&arena, bytes, 100, 10, 1);
+        sentest_assert(state, all_zero(senarena_alloc_zeroed(&arena, 90, 1), 90));
+        senarena_free(arena);
+      }
+      sentest(state, "are zero after rewinding") {
+        struct senarena arena = senarena_new_with_config(mmap_config);
+        const struct senarena_mark mark = senarena_mark(&arena);
+        for (int i = 0; i < 100; i++) {
+          memset(senarena_alloc(&arena, 200, 8), 0xff, 200);
+        }
+        senarena_rewind(&arena, mark);
+        bool zero = true;
+        for (int i = 0; i < 100; i++) {
+          zero = zero && all_zero(senarena_alloc_zeroed(&arena, 200, 8), 200);
+        }
+        sentest_assert(state, zero);
+        senarena_free(arena);
+      }
+      sentest(state, "can be large") {
+        static const enum senarena_backend backends[] = {SENARENA_BACKEND_MALLOC, SENARENA_BACKEND_MMAP};
+        for (size_t i = 0; i < STATIC_LEN(backends); i++) {
+          struct senarena_config config = { .backend = backends[i] };
+          struct senarena arena = senarena_new_with_config(config);
+          const size_t size = 1024 * 1024;
+          unsigned char *bytes = senarena_alloc_zeroed(&arena, size, 16);
+          sentest_assert_eq(state, (uintptr_t) bytes % 16, 0);
+          sentest_assert(state, all_zero(bytes, size));
+          senarena_free(arena);
+        }
+      }
+      sentest(state, "can be arrays") {
+        struct senarena arena = senarena_new();
+        memset(senarena_alloc(&arena, 1000, 1), 0xff, 1000);
+        senarena_clear(&arena);
+        uint64_t *ints = senarena_calloc_array_of(&arena, uint64_t, 100);
+        sentest_assert_eq(state, (uintptr_t) ints % SENARENA_ALIGNOF(uint64_t), 0);
+        sentest_assert(state, all_zero(ints, sizeof(uint64_t) * 100));
+        senarena_free(arena);
+      }
+      sentest(state, "are NULL when the allocator fails") {
+        struct counting_allocator counts = { .outstanding = 0, .remaining = 1 };
+        struct senarena arena = new_counting_arena(&counts);
+        sentest_assert_eq(state, senarena_alloc_zeroed(&arena, 2 * SENARENA_DEFAULT_CHUNK_SIZE, 1), NULL);
+        senarena_alloc(&arena, SENARENA_DEFAULT_CHUNK_SIZE - 100, 1);
+        sentest_assert_eq(state, senarena_alloc_zeroed(&arena, SENARENA_DEFAULT_CHUNK_SIZE / 8, 1), NULL);
+        senarena_free(arena);
+      }
+    }
+    sentest_group(state, "string builders") {
+      sentest(state, "append and format") {
+        struct senarena arena = senarena_new();
+        struct senarena_buf buf = senarena_str_new(&arena);
+        senarena_str_append(&buf, "GET ");
+        senarena_str_printf(&buf, "/users/%d/%s", 42, "posts");
+        const char *str = senarena_str_finish(&buf);
+        sentest_assert_eq(state, strcmp(str, "GET /users/42/posts"), 0);
+        sentest_assert_eq_fmt(state, "zu", buf.length, strlen(str));
+        senarena_free(arena);
+      }
+      sentest(state, "format more than their spare capacity") {
+        struct senarena arena = senarena_new();
+        struct senarena_buf buf = senarena_str_new(&arena);
+        for (int i = 0; i < 100; i++) {
+          senarena_str_printf(&buf, "%0100d", i);
+        }
+        const char *str = senarena_str_finish(&buf);
+        sentest_assert_eq_fmt(state, "zu", strlen(str), (size_t) 10000);
+        sentest_assert_eq(state, strncmp(str + 9900, "0000", 4), 0);
+        sentest_assert_eq(state, strcmp(str + 9998, "99"), 0);
+        senarena_free(arena);
+      }
+      sentest(state, "grow in place at the top of the arena") {
+        struct senarena arena = senarena_new();
+        struct senarena_buf buf = senarena_str_new(&arena);
+        senarena_str_append(&buf, "abc");
+        const char *str = senarena_str_finish(&buf);
+        sentest_assert_eq_fmt(state, "p", (void*) str, (void*) arena.top);
+        senarena_free(arena);
+      }
+      sentest(state, "can be empty") {
+        struct senarena arena = senarena_new();
+        struct senarena_buf buf = senarena_str_new(&arena);
+        sentest_assert_eq(state, strcmp(senarena_str_finish(&buf), ""), 0);
+        senarena_free(arena);
+      }
+      sentest(state, "format in one go") {
+        struct senarena arena = senarena_new();
+        sentest_assert_eq(state, strcmp(senarena_sprintf(&arena, "%s=%u", "answer", 42u), "answer=42"), 0);
+        senarena_free(arena);
+      }
+    }
+    sentest_group(state, "string interning") {
+      sentest(state, "gives equal strings the same address") {
+        struct senarena arena = senarena_new();
+        struct senarena_interner interner = senarena_interner_new(&arena);
+        char key[] = "content-type";
+        const char *a = senarena_intern(&interner, key, strlen(key));
+        key[0] = 'C';
+        const char *b = senarena_intern(&interner, "content-type", strlen("content-type"));
+        sentest_assert_eq(state, a, b);
+        sentest_assert_eq(state, strcmp(a, "content-type"), 0);
+        sentest_assert_neq(state, senarena_intern(&interner, key, strlen(key)), a);
+        sentest_assert_eq_fmt(state, "zu", interner.count, (size_t) 2);
+        senarena_free(arena);
+      }
+      sentest(state, "tells prefixes apart") {
+        struct senarena arena = senarena_new();
+        struct senarena_interner interner = senarena_interner_new(&arena);
+        const char *a = senarena_intern(&interner, "abc", 2);
+        const char *b = senarena_intern(&interner, "abc", 3);
+        sentest_assert_neq(state, a, b);
+        sentest_assert_eq(state, strcmp(a, "ab"), 0);
+        senarena_free(arena);
+      }
+      sentest(state, "keeps every string when growing") {
+        struct senarena arena = senarena_new();
+        struct senarena_interner interner = senarena_interner_new(&arena);
+        const char *strs[1000];
+        for (int i = 0; i < 1000; i++) {
+          struct senarena_buf buf = senarena_str_new(&arena);
+          senarena_str_printf(&buf, "key-%d", i);
+          strs[i] = senarena_intern_str(&interner, &buf);
+        }
+        bool same = true;
+        for (int i = 0; i < 1000; i++) {
+          struct senarena_buf buf = senarena_str_new(&arena);
+          senarena_str_printf(&buf, "key-%d", i);
+          same = same && senarena_intern_str(&interner, &buf) == strs[i];
+        }
+        sentest_assert(state, same);
+        sentest_assert_eq_fmt(state, "zu", interner.count, (size_t) 1000);
+        senarena_free(arena);
+      }
+      sentest(state, "give a duplicate builder's memory back") {
+        struct senarena arena = senarena_new();
+        struct senarena_interner interner = senarena_interner_new(&arena);
+        senarena_intern(&interner, "hello", 5);
+        const uintptr_t top = arena.top;
+        struct senarena_buf buf = senarena_str_new(&arena);
+        senarena_str_append(&buf, "hello");
+        senarena_intern_str(&interner, &buf);
+        sentest_assert_eq_fmt(state, "p", (void*) arena.top, (void*) top);
+        sentest_assert_eq(state, buf.data, NULL);
+        senarena_free(arena);
+      }
+    }
+    sentest_group(state, "cleanups") {
+      sentest(state, "run newest first when cleared") {
+        struct senarena arena = senarena_new();
+        struct cleanup_log log = { .length = 0 };
+        // enough for a few batches
+        for (int i = 0; i < 20; i++) {
+          struct cleanup_entry *entry = senarena_alloc_type(&arena, struct cleanup_entry);
+          entry->log = &log;
+          entry->id = i;
+          sentest_assert(state, senarena_on_clear(&arena, log_cleanup, entry));
+        }
+        senarena_clear(&arena);
+        sentest_assert_eq_fmt(state, "zu", log.length, (size_t) 20);
+        bool reversed = true;
+        for (int i = 0; i < 20; i++) {
+          reversed = reversed && log.order[i] == 19 - i;
+        }
+        sentest_assert(state, reversed);
+        sentest_assert_eq(state, arena.cleanups, NULL);
+        senarena_clear(&arena);
+        sentest_assert_eq_fmt(state, "zu", log.length, (size_t) 20);
+        senarena_free(arena);
+      }
+      sentest(state, "run when freed") {
+        struct senarena arena = senarena_new();
+        struct cleanup_log log = { .length = 0 };
+        struct cleanup_entry entry = { .log = &log, .id = 7 };
+        senarena_on_clear(&arena, log_cleanup, &entry);
+        senarena_free(arena);
+        sentest_assert_eq_fmt(state, "zu", log.length, (size_t) 1);
+        sentest_assert_eq(state, log.order[0], 7);
+      }
+      sentest(state, "registered after a mark run when rewinding") {
+        struct senarena arena = senarena_new();
+        struct cleanup_log log = { .length = 0 };
+        struct cleanup_entry entries[12];
+        for (int i = 0; i < 12; i++) {
+          entries[i].log = &log;
+          entries[i].id = i;
+        }
+        for (int i = 0; i < 3; i++) {
+          senarena_on_clear(&arena, log_cleanup, &entries[i]);
+        }
+        const struct senarena_mark mark = senarena_mark(&arena);
+        for (int i = 3; i < 12; i++) {
+          senarena_on_clear(&arena, log_cleanup, &entries[i]);
+        }
+        senarena_rewind(&arena, mark);
+        sentest_assert_eq_fmt(state, "zu", log.length, (size_t) 9);
+        sentest_assert_eq(state, log.order[0], 11);
+        sentest_assert_eq(state, log.order[8], 3);
+        senarena_on_clear(&arena, log_cleanup, &entries[11]);
+        senarena_clear(&arena);
+        sentest_assert_eq_fmt(state, "zu", log.length, (size_t) 13);
+        sentest_assert_eq(state, log.order[9], 11);
+        sentest_assert_eq(state, log.order[12], 0);
+        senarena_free(arena);
+      }
+      sentest(state, "aren't registered when the allocator fails") {
+        struct counting_allocator counts = { .outstanding = 0, .remaining = 1 };
+        struct senarena arena = new_counting_arena(&counts);
+        struct cleanup_log log = { .length = 0 };
+        struct cleanup_entry entry = { .log = &log, .id = 1 };
+        senarena_alloc(&arena, SENARENA_DEFAULT_CHUNK_SIZE - 8, 1);
+        sentest_assert(state, !senarena_on_clear(&arena, log_cleanup, &entry));
+        senarena_free(arena);
+        sentest_assert_eq_fmt(state, "zu", log.length, (size_t) 0);
+      }
+    }
+    sentest_group(state, "typed allocators") {
+      sentest(state, "return what senarena_alloc_type would") {
+        // identical buffers, so that the two arenas' addresses only differ by an offset
+        static union { struct typed_node align; unsigned char bytes[4096]; } generic_buf, typed_buf;
+        struct senarena generic = senarena_new_with_buffer(generic_buf.bytes, sizeof(generic_buf.bytes));
+        struct senarena typed = senarena_new_with_buffer(typed_buf.bytes, sizeof(typed_buf.bytes));
+        const uintptr_t offset = (uintptr_t) typed_buf.bytes - (uintptr_t) generic_buf.bytes;
+        bool same = true;
+        for (int i = 0; i < 100; i++) {
+          const uintptr_t generic_char = (uintptr_t) senarena_alloc_type(&generic, char);
+          const uintptr_t typed_char = (uintptr_t) typed_char_alloc(&typed);
+          const uintptr_t generic_node = (uintptr_t) senarena_alloc_type(&generic, struct typed_node);
+          const uintptr_t typed_node = (uintptr_t) typed_node_alloc(&typed);
+          same = same && typed_char - generic_char == offset && typed_node - generic_node == offset;
+        }
+        sentest_assert(state, same);
+        sentest_assert_eq(state, typed.top - generic.top, offset);
+        senarena_free(generic);
+        senarena_free(typed);
+      }
+      sentest(state, "move on to a new chunk when it's full") {
+        struct senarena arena = senarena_new();
+        struct typed_node *previous = NULL;
+        const size_t count = 3 * SENARENA_DEFAULT_CHUNK_SIZE / sizeof(struct typed_node);
+        for (size_t i = 0; i < count; i++) {
+          struct typed_node *node = typed_node_alloc(&arena);
+          node->next = previous;
+          node->key = (uint32_t) i;
+          previous = node;
+        }
+        sentest_assert(state, chain_length(current_chunk(&arena)) >= 3);
+        size_t length = 0;
+        bool ordered = true;
+        for (const struct typed_node *node = previous; node != NULL; node = node->next) {
+          ordered = ordered && node->key == count - 1 - length && is_aligned(node, SENARENA_ALIGNOF(struct typed_node));
+          length++;
+        }
+        sentest_assert_eq_fmt(state, "zu", length, count);
+        sentest_assert(state, ordered);
+        senarena_free(arena);
+      }
+      sentest(state, "allocate arrays in the current chunk") {
+        struct senarena arena = senarena_new();
+        const uintptr_t top = arena.top;
+        struct typed_node *nodes = typed_node_alloc_array(&arena, 10);
+        sentest_assert_eq(state, (uintptr_t) nodes, top - 10 * sizeof(struct typed_node));
+        struct typed_node *none = typed_node_alloc_array(&arena, 0);
+        sentest_assert_eq(state, (void*) none, (void*) arena.top);
+        senarena_free(arena);
+      }
+      sentest(state, "allocate arrays bigger than a chunk") {
+        struct senarena arena = senarena_new();
+        const size_t count = 2 * SENARENA_DEFAULT_CHUNK_SIZE / sizeof(struct typed_node);
+        struct typed_node *nodes = typed_node_alloc_array(&arena, count);
+        sentest_assert_neq(state, nodes, NULL);
+        memset(nodes, 0, count * sizeof(struct typed_node));
+        sentest_assert(state, is_aligned(nodes, SENARENA_ALIGNOF(struct typed_node)));
+        senarena_free(arena);
+      }
+      sentest(state, "return NULL when an array's size overflows") {
+        struct senarena arena = senarena_new();
+        const uintptr_t top = arena.top;
+        sentest_assert_eq(state, typed_node_alloc_array(&arena, SIZE_MAX / 2), NULL);
+        sentest_assert_eq(state, arena.top, top);
+        senarena_free(arena);
+      }
+      sentest(state, "return NULL from an arena without a chunk") {
+        struct counting_allocator counts = { .outstanding = 0, .remaining = 0 };
+        struct senarena arena = new_counting_arena(&counts);
+        sentest_assert_eq(state, typed_node_alloc(&arena), NULL);
+        sentest_assert_eq(state, typed_long_double_alloc(&arena), NULL);
+        sentest_assert_eq(state, typed_node_alloc_array(&arena, 4), NULL);
+        sentest_assert_eq(state, typed_long_double_alloc_array(&arena, 4), NULL);
+        counts.remaining = SIZE_MAX;
+        struct typed_node *node = typed_node_alloc(&arena);
+        sentest_assert_neq(state, node, NULL);
+        node->key = 1;
+        struct typed_node *nodes = typed_node_alloc_array(&arena, 4);
+        sentest_assert_neq(state, nodes, NULL);
+        nodes[3].key = 4;
+        senarena_free(arena);
+        sentest_assert_eq_fmt(state, "zu", counts.outstanding, (size_t) 0);
+      }
+      sentest(state, "stay in chunks whose start isn't as aligned as the type") {
+        // a buffer whose chunk starts 8 bytes past a 16-byte boundary
+        static union { long double align; unsigned char bytes[512]; } buf;
+        struct senarena arena = senarena_new_with_buffer(buf.bytes + 8, sizeof(buf.bytes) - 8);
+        const uintptr_t bottom = arena.bottom;
+        bool inside = true;
+        for (int i = 0; i < 100; i++) {
+          // a char between them leaves the top unaligned
+          if (i % 2 == 0) typed_char_alloc(&arena);
+          long double *ptr = i % 3 == 0 ? typed_long_double_alloc_array(&arena, 3) : typed_long_double_alloc(&arena);
+          inside = inside
+            && is_aligned(ptr, SENARENA_ALIGNOF(long double))
+            && ((uintptr_t) ptr >= arena.bottom || arena.bottom != bottom);
+          *ptr = 1.0L;
+        }
+        sentest_assert(state, inside);
+        senarena_free(arena);
+      }
+    }
+    sentest_group(state, "deferred freeing") {
+      sentest(state, "hands every chunk over") {
+        senarena_reclaim();
+        struct senarena arena = senarena_new();
+        for (int i = 0; i < 10; i++) {
+          senarena_alloc(&arena, 1000, 1);
+        }
+        senarena_clear(&arena);
+        senarena_alloc(&arena, 1000, 1);
+        senarena_alloc(&arena, 3 * SENARENA_DEFAULT_CHUNK_SIZE, 1);
+        const size_t chunks = chain_length(current_chunk(&arena)) + chain_length(arena.fresh_chunks);
+        sentest_assert(state, chunks > 3);
+        senarena_free_deferred(arena);
+        const size_t reclaimed = senarena_reclaim();
+        sentest_assert_eq_fmt(state, "zu", reclaimed, chunks);
+        sentest_assert_eq(state, senarena_reclaim(), 0);
+      }
+      sentest(state, "hands chunks over to the next arena") {
+        senarena_reclaim();
+        struct senarena arena = senarena_new();
+        for (int i = 0; i < 10; i++) {
+          senarena_alloc(&arena, 1000, 1);
+        }
+        const struct senarena_chunk_header *current = current_chunk(&arena);
+        const size_t chunks = chain_length(current);
+        senarena_free_deferred(arena);
+        struct senarena next = senarena_new();
+        sentest_assert_eq(state, current_chunk(&next), current);
+        sentest_assert_eq_fmt(state, "zu", chain_length(next.fresh_chunks), chunks - 1);
+        sentest_assert_eq(state, senarena_reclaim(), 0);
+        // and it's a working arena
+        for (int i = 0; i < 20; i++) {
+          memset(senarena_alloc(&next, 1000, 1), 1, 1000);
+        }
+        sentest_assert_eq(state, next.fresh_chunks, NULL);
+        senarena_free(next);
+      }
+      sentest(state, "are only taken over by senarena_new") {
+        senarena_reclaim();
+        struct senarena arena = senarena_new();
+        for (int i = 0; i < 10; i++) {
+          senarena_alloc(&arena, 1000, 1);
+        }
+        const size_t chunks = chain_length(current_chunk(&arena));
+        senarena_free_deferred(arena);
+        // the caller's allocator and chunk size
+        struct counting_allocator counts = { .outstanding = 0, .remaining = SIZE_MAX };
+        struct senarena_config config = {
+          .chunk_size = 4 * SENARENA_DEFAULT_CHUNK_SIZE,
+          .allocator = { .alloc = counting_alloc, .free = counting_free, .context = &counts },
+        };
+        struct senarena configured = senarena_new_with_config(config);
+        sentest_assert_eq_fmt(state, "zu", counts.outstanding, (size_t) 1);
+        sentest_assert_eq_fmt(state, "zu", (size_t) current_chunk(&configured)->capacity, (size_t) (4 * SENARENA_DEFAULT_CHUNK_SIZE));
+        sentest_assert_eq(state, configured.fresh_chunks, NULL);
+        senarena_free(configured);
+        sentest_assert_eq_fmt(state, "zu", counts.outstanding, (size_t) 0);
+        const size_t reclaimed = senarena_reclaim();
+        sentest_assert_eq_fmt(state, "zu", reclaimed, chunks);
+      }
+      sentest(state, "make arenas like senarena_new's") {
+        senarena_reclaim();
+        struct senarena arena = senarena_new();
+        for (int i = 0; i < 10; i++) {
+          senarena_alloc(&arena, 1000, 1);
+        }
+        const size_t chunks = chain_length(current_chunk(&arena));
+        senarena_free_deferred(arena);
+        struct senarena next = senarena_new();
+        sentest_assert(state, next.fresh_chunks != NULL);
+        sentest_assert_eq(state, next.allocator.alloc, NULL);
+        sentest_assert_eq_fmt(state, "zu", next.chunk_size, (size_t) SENARENA_DEFAULT_CHUNK_SIZE);
+        sentest_assert_eq_fmt(state, "zu", next.max_chunk_size, (size_t) SENARENA_DEFAULT_CHUNK_SIZE);
+        // once the handed over chunks run out, new ones are default-sized
+        for (int i = 0; i < 40; i++) {
+          senarena_alloc(&next, 1000, 1);
+        }
+        bool default_sized = true;
+        for (const struct senarena_chunk_header *chunk = current_chunk(&next); chunk != NULL; chunk = chunk->ptr) {
+          default_sized = default_sized && chunk->capacity == SENARENA_DEFAULT_CHUNK_SIZE;
+        }
+        sentest_assert(state, default_sized);
+        sentest_assert(state, chain_length(current_chunk(&next)) > chunks);
+        senarena_free(next);
+      }
+      sentest(state, "runs cleanups right away") {
+        struct senarena arena = senarena_new();
+        struct cleanup_log log = { .length = 0 };
+        struct cleanup_entry entry = { .log = &log, .id = 3 };
+        senarena_on_clear(&arena, log_cleanup, &entry);
+        senarena_free_deferred(arena);
+        sentest_assert_eq_fmt(state, "zu", log.length, (size_t) 1);
+        senarena_reclaim();
+      }
+      sentest(state, "frees arenas with an allocator right away") {
+        senarena_reclaim();
+        struct counting_allocator counts = { .outstanding = 0, .remaining = 10 };
+        struct senarena arena = new_counting_arena(&counts);
+        senarena_alloc(&arena, SENARENA_DEFAULT_CHUNK_SIZE, 1);
+        senarena_free_deferred(arena);
+        sentest_assert_eq_fmt(state, "zu", counts.outstanding, (size_t) 0);
+        sentest_assert_eq(state, senarena_reclaim(), 0);
+      }
+      sentest(state, "leaves the caller's buffer alone") {
+        senarena_reclaim();
+        static unsigned char buf[256];
+        struct senarena arena = senarena_new_with_buffer(buf, sizeof(buf));
+        senarena_alloc(&arena, 1000, 1);
+        senarena_free_deferred(arena);
+        sentest_assert_eq(state, senarena_reclaim(), 0);
+      }
+      sentest(state, "frees everything handed over before the reclaimer stops") {
+        senarena_reclaim();
+        sentest_assert(state, senarena_reclaimer_start());
+        sentest_assert(state, senarena_reclaimer_start());
+        for (int i = 0; i < 100; i++) {
+          struct senarena arena = senarena_new();
+          senarena_alloc(&arena, 3 * SENARENA_DEFAULT_CHUNK_SIZE, 1);
+          senarena_free_deferred(arena);
+        }
+        senarena_reclaimer_stop();
+        senarena_reclaimer_stop();
+        sentest_assert_eq(state, senarena_reclaim(), 0);
+      }
+    }
+    sentest_group(state, "relative pointers") {
+      sentest(state, "resolve to their target") {
+        struct { struct senarena_relptr rel; int target; } pair = { .target = 42 };
+        senarena_relptr_set(&pair.rel, &pair.target);
+        sentest_assert_eq(state, senarena_relptr_get(&pair.rel), &pair.target);
+      }
+      sentest(state, "can be NULL") {
+        struct senarena_relptr rel;
+        senarena_relptr_set(&rel, NULL);
+        sentest_assert_eq(state, rel.offset, 0);
+        sentest_assert_eq(state, senarena_relptr_get(&rel), NULL);
+      }
+      sentest(state, "survive being copied along with their target") {
+        struct image_node nodes[2];
+        senarena_relptr_set(&nodes[0].next, &nodes[1]);
+        nodes[1].value = 7;
+        struct image_node copy[2];
+        memcpy(copy, nodes, sizeof(nodes));
+        const struct image_node *next = senarena_relptr_get(&copy[0].next);
+        sentest_assert_eq(state, next, &copy[1]);
+        sentest_assert_eq(state, next->value, 7);
+      }
+    }
+    sentest_group(state, "images") {
+      sentest(state, "return NULL when too small for a chunk") {
+        struct senarena_image image = senarena_image_new(64);
+        sentest_assert_neq(state, image.base, NULL);
+        sentest_assert_eq(state, senarena_alloc(&image.arena, 100000, 1), NULL);
+        sentest_assert_eq(state, senarena_alloc(&image.arena, 16, 1), NULL);
+        senarena_clear(&image.arena);
+        senarena_image_free(image);
+      }
+      sentest(state, "keep their chunks in one reservation") {
+        struct senarena_image image = senarena_image_new(1024 * 1024);
+        sentest_assert_neq(state, image.base, NULL);
+        build_image_list(&image, 2000);
+        const uintptr_t base = (uintptr_t) image.base;
+        const size_t size = senarena_image_size(&image);
+        size_t chunks = 0;
+        for (const struct senarena_chunk_header *chunk = current_chunk(&image.arena); chunk != NULL; chunk = chunk->ptr) {
+          chunks++;
+          sentest_assert(state, (uintptr_t) chunk >= base && (uintptr_t) chunk - base < size);
+        }
+        sentest_assert(state, chunks > 1);
+        senarena_image_free(image);
+      }
+      sentest(state, "load what was saved") {
+        struct senarena_image image = senarena_image_new(1024 * 1024);
+        const struct image_node *head = build_image_list(&image, 1000);
+        sentest_assert(state, senarena_image_save(&image, head, IMAGE_PATH));
+        struct senarena_loaded_image loaded = senarena_image_load(IMAGE_PATH);
+        sentest_assert_neq(state, loaded.base, NULL);
+        sentest_assert_eq(state, loaded.size, senarena_image_size(&image));
+        sentest_assert_neq(state, loaded.root, (const void*) head);
+        // the builder's memory is gone, but the loaded list doesn't refer to it
+        senarena_image_free(image);
+        int expected = 999;
+        bool names_match = true;
+        for (const struct image_node *node = loaded.root; node != NULL; node = senarena_relptr_get(&node->next)) {
+          char name[32];
+          snprintf(name, sizeof(name), "node %d", expected);
+          names_match = names_match && node->value == expected && strcmp(senarena_relptr_get(&node->name), name) == 0;
+          expected--;
+        }
+        sentest_assert_eq(state, expected, -1);
+        sentest_assert(state, names_match);
+        senarena_image_unload(loaded);
+        remove(IMAGE_PATH);
+      }
+      sentest(state, "can be loaded more than once") {
+        struct senarena_image image = senarena_image_new(64 * 1024);
+        const struct image_node *head = build_image_list(&image, 10);
+        senarena_image_save(&image, head, IMAGE_PATH);
+        senarena_image_free(image);
+        struct senarena_loaded_image first = senarena_image_load(IMAGE_PATH);
+        struct senarena_loaded_image second = senarena_image_load(IMAGE_PATH);
+        sentest_assert_neq(state, first.base, second.base);
+        const struct image_node *first_root = first.root;
+        const struct image_node *second_root = second.root;
+        sentest_assert_eq(state, first_root->value, 9);
+        sentest_assert_eq(state, second_root->value, 9);
+        senarena_image_unload(first);
+        senarena_image_unload(second);
+        remove(IMAGE_PATH);
+      }
+      sentest(state, "can have no root") {
+        struct senarena_image image = senarena_image_new(64 * 1024);
+        senarena_image_save(&image, NULL, IMAGE_PATH);
+        senarena_image_free(image);
+        struct senarena_loaded_image loaded = senarena_image_load(IMAGE_PATH);
+        sentest_assert_neq(state, loaded.base, NULL);
+        sentest_assert_eq(state, loaded.root, NULL);
+        senarena_image_unload(loaded);
+        remove(IMAGE_PATH);
+      }
+      sentest(state, "won't save a root outside the image") {
+        struct senarena_image image = senarena_image_new(64 * 1024);
+        int outside = 0;
+        sentest_assert(state, !senarena_image_save(&image, &outside, IMAGE_PATH));
+        senarena_image_free(image);
+      }
+      sentest(state, "return NULL when the allocator runs out of room") {
+        struct senarena_image image = senarena_image_new(64 * 1024);
+        sentest_assert_eq(state, senarena_alloc(&image.arena, 128 * 1024, 1), NULL);
+        senarena_image_free(image);
+      }
+      sentest(state, "won't load missing or foreign files") {
+        sentest_assert_eq(state, senarena_image_load("this-file-does-not-exist.img").base, NULL);
+        FILE *file = fopen(IMAGE_PATH, "wb");
+        fputs("not an arena image, but long enough to have a header", file);
+        fclose(file);
+        sentest_assert_eq(state, senarena_image_load(IMAGE_PATH).base, NULL);
+        remove(IMAGE_PATH);
+      }
+    }
+    sentest_group(state, "frame arenas") {
+      sentest(state, "keep the previous frame's data") {
+        struct senframe frame = senframe_new(2);
+        int *previous = senarena_alloc_type(senframe_arena(&frame, 0), int);
+        *previous = 42;
+        struct senarena *current = senframe_advance(&frame);
+        sentest_assert_eq(state, senframe_arena(&frame, 0), current);
+        senarena_alloc_type(current, int);
+        sentest_assert_eq(state, *previous, 42);
+        senframe_free(frame);
+      }
+      sentest(state, "clear the oldest frame when advancing") {
+        struct senframe frame = senframe_new(3);
+        struct senarena *first = senframe_arena(&frame, 0);
+        const uintptr_t initial_top = first->top;
+        senarena_alloc(first, 100, 1);
+        senframe_advance(&frame);
+        senframe_advance(&frame);
+        sentest_assert_eq(state, senframe_arena(&frame, 2), first);
+        sentest_assert(state, first->top < initial_top);
+        sentest_assert_eq(state, senframe_advance(&frame), first);
+        sentest_assert_eq_fmt(state, "p", (void*) first->top, (void*) initial_top);
+        senframe_free(frame);
+      }
+      sentest(state, "use the config for every arena") {
+        struct senarena_config config = {
+          .chunk_size = 1024,
+        };
+        struct senframe frame = senframe_new_with_config(4, config);
+        for (unsigned i = 0; i < 4; i++) {
+          struct senarena *arena = senframe_arena(&frame, i);
+          sentest_assert_eq(state, arena->top - arena->bottom, 1024);
+        }
+        senframe_free(frame);
+      }
+    }
+#ifdef SENARENA_STATS
+    sentest_group(state, "statistics") {
+      sentest(state, "count live bytes and padding") {
+        struct senarena arena = senarena_new();
+        senarena_alloc(&arena, 3, 1);
+        senarena_alloc(&arena, 8, 8);
+        const struct senarena_stats stats = senarena_stats(&arena);
+        sentest_assert_eq(state, stats.live_bytes, 11);
+        sentest_assert_eq(state, stats.padding_bytes, 5);
+        sentest_assert_eq(state, stats.chunks, 1);
+        senarena_free(arena);
+      }
+      sentest(state, "count dedicated chunks") {
+        struct senarena arena = senarena_new();
+        senarena_alloc(&arena, 1, 1);
+        senarena_alloc(&arena, SENARENA_DEFAULT_CHUNK_SIZE, 1);
+        const struct senarena_stats stats = senarena_stats(&arena);
+        sentest_assert_eq(state, stats.chunks, 2);
+        sentest_assert_eq(state, stats.dedicated_chunks, 1);
+        senarena_free(arena);
+      }
+      sentest(state, "count reused chunks") {
+        struct senarena arena = senarena_new();
+        for (int i = 0; i < 10; i++) {
+          senarena_alloc(&arena, 1000, 1);
+        }
+        const size_t chunks = senarena_stats(&arena).chunks;
+        sentest_assert(state, chunks > 1);
+        senarena_clear(&arena);
+        for (int i = 0; i < 10; i++) {
+          senarena_alloc(&arena, 1000, 1);
+        }
+        const struct senarena_stats stats = senarena_stats(&arena);
+        sentest_assert_eq(state, stats.chunks, chunks);
+        sentest_assert_eq(state, stats.fresh_chunk_reuses, chunks - 1);
+        senarena_free(arena);
+      }
+      sentest(state, "keep the peak across clears") {
+        struct senarena arena = senarena_new();
+        senarena_alloc(&arena, 100, 1);
+        senarena_clear(&arena);
+        senarena_alloc(&arena, 10, 1);
+        const struct senarena_stats stats = senarena_stats(&arena);
+        sentest_assert_eq(state, stats.live_bytes, 10);
+        sentest_assert_eq(state, stats.peak_live_bytes, 100);
+        senarena_free(arena);
+      }
+      sentest(state, "are restored when rewinding") {
+        struct senarena arena = senarena_new();
+        senarena_alloc(&arena, 10, 1);
+        const struct senarena_mark mark = senarena_mark(&arena);
+        senarena_alloc(&arena, 10000, 1);
+        senarena_alloc(&arena, 7, 4);
+        senarena_rewind(&arena, mark);
+        const struct senarena_stats stats = senarena_stats(&arena);
+        sentest_assert_eq(state, stats.live_bytes, 10);
+        sentest_assert_eq(state, stats.padding_bytes, 0);
+        sentest_assert(state, stats.peak_live_bytes >= 10017);
+        senarena_free(arena);
+      }
+      sentest(state, "follow the last allocation when it's resized") {
+        struct senarena arena = senarena_new();
+        void *ptr = senarena_alloc(&arena, 16, 1);
+        ptr = senarena_realloc_last(&arena, ptr, 16, 64, 1);
+        sentest_assert_eq(state, senarena_stats(&arena).live_bytes, 64);
+        senarena_realloc_last(&arena, ptr, 64, 32, 1);
+        sentest_assert_eq(state, senarena_stats(&arena).live_bytes, 32);
+        senarena_free(arena);
+      }
+    }
+#else
+    sentest(state, "statistics are zero when disabled") {
+      struct senarena arena = senarena_new();
+      senarena_alloc(&arena, 100, 1);
+      const struct senarena_stats stats = senarena_stats(&arena);
+      sentest_assert_eq(state, stats.live_bytes, 0);
+      sentest_assert_eq(state, stats.chunks, 0);
+      senarena_free(arena);
     }
+#endif
     sentest_group(state, "fuzz tests") {
       const int n = 1;
 
@@ -0,0 +1,121 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef SENSIBLE_POOL_H
+#define SENSIBLE_POOL_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sensible-macros.h"
+
+// Allocator for objects of a single size.
+// Frees objects individually.
+// Reuses freed objects first, most recently freed first.
+
+#if defined(__GNUC__) || defined(__clang__)
+#define senpool_unlikely(x)     (__builtin_expect(!!(x),false))
+#define senpool_likely(x)       (__builtin_expect(!!(x),true))
+#elif (defined(__cplusplus) && (__cplusplus >= 202002L)) || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+#define senpool_unlikely(x)     (x) [[unlikely]]
+#define senpool_likely(x)       (x) [[likely]]
+#else
+#define senpool_unlikely(x)     (x)
+#define senpool_likely(x)       (x)
+#endif
+
+#define senpool_malloc
+#define senpool_always_inline inline
+
+#if defined(__has_attribute)
+# if __has_attribute(malloc)
+#  undef senpool_malloc
+#  define senpool_malloc __attribute__((__malloc__))
+# endif
+# if __has_attribute(always_inline)
+#  undef senpool_always_inline
+#  define senpool_always_inline inline __attribute__((__always_inline__))
+# endif
+#endif
+
+#ifndef SENPOOL_SLAB_SIZE
+# define SENPOOL_SLAB_SIZE (64 * 1024)
+#endif
+
+#define SENPOOL_SIMPLE_ALIGNOF(t) (sizeof(t) <= 1 ? 1 : offsetof(struct { char c; t x; }, x))
+#define SENPOOL_ALIGNOF(t) (sizeof(t) < SENPOOL_SIMPLE_ALIGNOF(t) ? sizeof(t) : SENPOOL_SIMPLE_ALIGNOF(t))
+
+// Free objects hold the next free object
+struct senpool_free_object {
+  struct senpool_free_object *next;
+};
+
+// At the start of every slab
+struct senpool_slab_header {
+  // previously allocated slab
+  struct senpool_slab_header *next;
+};
+
+struct senpool {
+  // most recently freed object
+  struct senpool_free_object *free_objects;
+  // objects in the newest slab that have never been handed out
+  // are between these two
+  uintptr_t top;
+  uintptr_t end;
+  // newest slab
+  struct senpool_slab_header *slabs;
+  // object size, rounded up to the alignment, and to fit a free object
+  size_t object_size;
+  size_t alignment;
+};
+
+senmac_public struct senpool senpool_new(size_t object_size, size_t alignment);
+#if defined(SENPOOL_NOINLINE) && !defined(SENPOOL_IMPL)
+senmac_public void *senpool_alloc(struct senpool *restrict pool) senpool_malloc;
+senmac_public void senpool_dealloc(struct senpool *restrict pool, void *ptr);
+#endif
+// Frees every slab, along with the objects in them
+senmac_public void senpool_free(struct senpool pool);
+senmac_public void *senpool_alloc_more(struct senpool *restrict pool);
+
+#define senpool_new_of(type) senpool_new(sizeof(type), SENPOOL_ALIGNOF(type))
+
+#if defined(SENPOOL_IMPL) || !defined(SENPOOL_NOINLINE)
+
+#ifndef SENPOOL_IMPL
+extern senpool_always_inline
+#endif
+senpool_malloc
+void *senpool_alloc(struct senpool *restrict pool) {
+  struct senpool_free_object *res = pool->free_objects;
+  if senpool_unlikely(res == NULL) {
+    return senpool_alloc_more(pool);
+  }
+  pool->free_objects = res->next;
+  return res;
+}
+
+#ifndef SENPOOL_IMPL
+extern senpool_always_inline
+#endif
+void senpool_dealloc(struct senpool *restrict pool, void *ptr) {
+  struct senpool_free_object *object = (struct senpool_free_object*) ptr;
+  object->next = pool->free_objects;
+  pool->free_objects = object;
+}
+
+#endif // defined(SENPOOL_IMPL) || !defined(SENPOOL_NOINLINE)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ifndef SENSIBLE_POOL_H
@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <assert.h>
+#include <stdbool.h>
+// for perror
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "sensible-macros.h"
+
+#define SENPOOL_IMPL
+#include "../include/sensible-pool.h"
+#undef SENPOOL_IMPL
+
+// Objects are carved out of slabs, bottom to top, the first time they're
+// allocated. Once freed, they go on an intrusive free list, which is
+// where allocations come from first.
+//
+//   -------------------------------------------------------
+//   | header | object | object | ... | untouched objects  |
+//   -------------------------------------------------------
+//                                    ^                    ^
+//                                    top                  end
+//
+// Slabs are only returned to the system when the pool is freed.
+
+#define SENPOOL_SLAB_HEADER_SIZE sizeof(struct senpool_slab_header)
+
+static
+uintptr_t senpool_align_up(uintptr_t addr, uintptr_t alignment) {
+  return (addr + alignment - 1) & -alignment;
+}
+
+senmac_public
+struct senpool senpool_new(size_t object_size, size_t alignment) {
+  assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+  if (alignment < SENPOOL_ALIGNOF(struct senpool_free_object)) {
+    alignment = SENPOOL_ALIGNOF(struct senpool_free_object);
+  }
+  if (object_size < sizeof(struct senpool_free_object)) {
+    object_size = sizeof(struct senpool_free_object);
+  }
+  struct senpool res = {
+    .free_objects = NULL,
+    .top = 0,
+    .end = 0,
+    .slabs = NULL,
+    .object_size = senpool_align_up(object_size, alignment),
+    .alignment = alignment,
+  };
+  return res;
+}
+
+// Makes the next slab's objects available
+static
+void senpool_slab_new(struct senpool *restrict pool) {
+  size_t size = SENPOOL_SLAB_HEADER_SIZE + pool->alignment + pool->object_size;
+  if (size < SENPOOL_SLAB_SIZE) size = SENPOOL_SLAB_SIZE;
+  struct senpool_slab_header *slab = (struct senpool_slab_header*) malloc(size);
+  if (slab == NULL) {
+    perror("Couldn't allocate pool slab");
+    exit(1);
+  }
+  slab->next = pool->slabs;
+  pool->slabs = slab;
+  pool->top = senpool_align_up((uintptr_t) slab + SENPOOL_SLAB_HEADER_SIZE, pool->alignment);
+  pool->end = (uintptr_t) slab + size;
+}
+
+senmac_public
+void *senpool_alloc_more(struct senpool *restrict pool) {
+  if senpool_unlikely(pool->end - pool->top < pool->object_size) {
+    senpool_slab_new(pool);
+  }
+  void *res = (void*) pool->top;
+  pool->top += pool->object_size;
+  return res;
+}
+
+senmac_public
+void senpool_free(struct senpool pool) {
+  struct senpool_slab_header *slab = pool.slabs;
+  while (slab != NULL) {
+    struct senpool_slab_header *next = slab->next;
+    free(slab);
+    slab = next;
+  }
+}
@@ -0,0 +1,110 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: CC0-1.0
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sensible-timing.h"
+#include "sensible-pool.h"
+
+#define ROUNDS 10
+#define OPERATIONS (16 * 1024 * 1024)
+
+// Sizes of connection- and timer-like records
+static const size_t object_sizes[] = {16, 64, 256};
+// Numbers of objects that can be live at once
+static const unsigned long slot_counts[] = {1024, 64 * 1024, 1024 * 1024};
+
+// The same pseudo-random operation sequence is replayed for each allocator
+static
+uint32_t next_random(uint32_t *state) {
+  // xorshift32
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+// Each operation picks a random slot, and frees its object if it has one,
+// otherwise allocates one. Half of the slots end up live, on average.
+static
+uint64_t malloc_round(volatile uint64_t **slots, unsigned long num_slots, size_t object_size) {
+  uint32_t random = 42;
+  const struct seninstant begin = seninstant_now();
+  for (unsigned long i = 0; i < OPERATIONS; i++) {
+    const unsigned long slot = next_random(&random) % num_slots;
+    if (slots[slot] == NULL) {
+      volatile uint64_t *obj = malloc(object_size);
+      obj[0] = i;
+      slots[slot] = obj;
+    } else {
+      free((void*) slots[slot]);
+      slots[slot] = NULL;
+    }
+  }
+  const uint64_t res = seninstant_subtract(seninstant_now(), begin);
+  for (unsigned long i = 0; i < num_slots; i++) {
+    free((void*) slots[i]);
+    slots[i] = NULL;
+  }
+  return res;
+}
+
+static
+uint64_t pool_round(volatile uint64_t **slots, unsigned long num_slots, size_t object_size) {
+  uint32_t random = 42;
+  struct senpool pool = senpool_new(object_size, 8);
+  const struct seninstant begin = seninstant_now();
+  for (unsigned long i = 0; i < OPERATIONS; i++) {
+    const unsigned long slot = next_random(&random) % num_slots;
+    if (slots[slot] == NULL) {
+      volatile uint64_t *obj = senpool_alloc(&pool);
+      obj[0] = i;
+      slots[slot] = obj;
+    } else {
+      senpool_dealloc(&pool, (void*) slots[slot]);
+      slots[slot] = NULL;
+    }
+  }
+  const uint64_t res = seninstant_subtract(seninstant_now(), begin);
+  senpool_free(pool);
+  memset((void*) slots, 0, sizeof(uint64_t*) * num_slots);
+  return res;
+}
+
+static
+uint64_t best_of(uint64_t (*round)(volatile uint64_t**, unsigned long, size_t), volatile uint64_t **slots, unsigned long num_slots, size_t object_size) {
+  uint64_t best = UINT64_MAX;
+  for (int i = 0; i < ROUNDS; i++) {
+    const uint64_t nanos = round(slots, num_slots, object_size);
+    if (nanos < best) best = nanos;
+  }
+  return best;
+}
+
+int main(void) {
+  const unsigned long max_slots = slot_counts[sizeof(slot_counts) / sizeof(slot_counts[0]) - 1];
+  volatile uint64_t **slots = calloc(max_slots, sizeof(uint64_t*));
+
+  puts("# Random alloc/free interleaving");
+  printf("%d operations, best of %d rounds.\n\n", OPERATIONS, ROUNDS);
+  for (size_t i = 0; i < sizeof(object_sizes) / sizeof(object_sizes[0]); i++) {
+    for (size_t j = 0; j < sizeof(slot_counts) / sizeof(slot_counts[0]); j++) {
+      const uint64_t malloc_nanos = best_of(malloc_round, slots, slot_counts[j], object_sizes[i]);
+      const uint64_t pool_nanos = best_of(pool_round, slots, slot_counts[j], object_sizes[i]);
+      printf("%4zu bytes, %8lu slots: malloc %8.3f ops/μs, pool %8.3f ops/μs, speedup %.3f\n",
+        object_sizes[i],
+        slot_counts[j],
+        1000 * (double) OPERATIONS / malloc_nanos,
+        1000 * (double) OPERATIONS / pool_nanos,
+        (double) malloc_nanos / pool_nanos);
+    }
+  }
+  free(slots);
+}
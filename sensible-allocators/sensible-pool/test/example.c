@@ -0,0 +1,22 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: CC0-1.0
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "sensible-pool.h"
+
+struct timer {
+  uint64_t deadline;
+  struct timer *next;
+};
+
+int main(void) {
+  struct senpool pool = senpool_new_of(struct timer);
+  struct timer *a = senpool_alloc(&pool);
+  a->deadline = 42;
+  senpool_dealloc(&pool, a);
+  senpool_free(pool);
+  return 0;
+}
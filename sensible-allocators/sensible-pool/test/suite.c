@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: CC0-1.0
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sensible-pool.h"
+#include "sensible-test.h"
+#include "sensible-macros.h"
+
+struct node {
+  uint64_t key;
+  struct node *left;
+  struct node *right;
+};
+
+senmac_public
+void run_sensible_pool_suite(struct sentest_state *state) {
+  sentest_group(state, "sensible-pool") {
+    sentest(state, "can be constructed and freed") {
+      struct senpool pool = senpool_new_of(struct node);
+      senpool_free(pool);
+    }
+    sentest(state, "rounds objects up to fit a free list link") {
+      struct senpool pool = senpool_new(1, 1);
+      sentest_assert(state, pool.object_size >= sizeof(void*));
+      senpool_free(pool);
+    }
+    sentest(state, "reuses the most recently freed object") {
+      struct senpool pool = senpool_new_of(struct node);
+      struct node *a = senpool_alloc(&pool);
+      struct node *b = senpool_alloc(&pool);
+      sentest_assert_neq(state, a, b);
+      senpool_dealloc(&pool, a);
+      senpool_dealloc(&pool, b);
+      sentest_assert_eq(state, senpool_alloc(&pool), b);
+      sentest_assert_eq(state, senpool_alloc(&pool), a);
+      senpool_free(pool);
+    }
+    sentest(state, "aligns objects") {
+      const size_t alignments[] = {1, 2, 8, 16, 64, 256};
+      for (size_t i = 0; i < sizeof(alignments) / sizeof(alignments[0]); i++) {
+        struct senpool pool = senpool_new(24, alignments[i]);
+        for (int j = 0; j < 10000; j++) {
+          const uintptr_t ptr = (uintptr_t) senpool_alloc(&pool);
+          if (ptr % alignments[i] != 0) {
+            sentest_failf(state, "%p isn't aligned to %zu", (void*) ptr, alignments[i]);
+            break;
+          }
+        }
+        senpool_free(pool);
+      }
+    }
+    sentest(state, "allocates objects larger than a slab") {
+      struct senpool pool = senpool_new(SENPOOL_SLAB_SIZE * 2, 8);
+      unsigned char *a = senpool_alloc(&pool);
+      unsigned char *b = senpool_alloc(&pool);
+      memset(a, 1, SENPOOL_SLAB_SIZE * 2);
+      memset(b, 2, SENPOOL_SLAB_SIZE * 2);
+      sentest_assert_eq(state, a[SENPOOL_SLAB_SIZE * 2 - 1], 1);
+      senpool_free(pool);
+    }
+    sentest_group(state, "fuzz tests") {
+      // Randomly allocates and frees objects, filled with their slot's
+      // number, checking that no object was overwritten
+      const int slots = 10000;
+      struct node **nodes = calloc(slots, sizeof(struct node*));
+      struct senpool pool = senpool_new_of(struct node);
+      bool intact = true;
+      for (int i = 0; i < 200000; i++) {
+        const int slot = rand() % slots;
+        if (nodes[slot] == NULL) {
+          nodes[slot] = senpool_alloc(&pool);
+          nodes[slot]->key = slot;
+          nodes[slot]->left = nodes[slot];
+          nodes[slot]->right = nodes[slot];
+        } else {
+          struct node *node = nodes[slot];
+          intact = intact && node->key == (uint64_t) slot && node->left == node && node->right == node;
+          senpool_dealloc(&pool, node);
+          nodes[slot] = NULL;
+        }
+      }
+      sentest(state, "objects don't overlap") {
+        sentest_assert(state, intact);
+      }
+      sentest(state, "objects are intact at the end") {
+        for (int slot = 0; slot < slots; slot++) {
+          struct node *node = nodes[slot];
+          if (node != NULL && node->key != (uint64_t) slot) {
+            sentest_failf(state, "slot %d holds %" PRIu64, slot, node->key);
+            break;
+          }
+        }
+      }
+      senpool_free(pool);
+      free(nodes);
+    }
+  }
+}
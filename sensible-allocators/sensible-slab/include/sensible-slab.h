@@ -0,0 +1,151 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef SENSIBLE_SLAB_H
+#define SENSIBLE_SLAB_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sensible-macros.h"
+#include "sensible-arena.h"
+
+// Allocator for small objects of mixed sizes.
+// Frees objects individually, given their size.
+// Each size class has its own free list.
+
+#if defined(__GNUC__) || defined(__clang__)
+#define senslab_unlikely(x)     (__builtin_expect(!!(x),false))
+#define senslab_likely(x)       (__builtin_expect(!!(x),true))
+#elif (defined(__cplusplus) && (__cplusplus >= 202002L)) || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+#define senslab_unlikely(x)     (x) [[unlikely]]
+#define senslab_likely(x)       (x) [[likely]]
+#else
+#define senslab_unlikely(x)     (x)
+#define senslab_likely(x)       (x)
+#endif
+
+#define senslab_malloc
+#define senslab_always_inline inline
+
+#if defined(__has_attribute)
+# if __has_attribute(malloc)
+#  undef senslab_malloc
+#  define senslab_malloc __attribute__((__malloc__))
+# endif
+# if __has_attribute(always_inline)
+#  undef senslab_always_inline
+#  define senslab_always_inline inline __attribute__((__always_inline__))
+# endif
+#endif
+
+#ifndef SENSLAB_SLAB_SIZE
+# define SENSLAB_SLAB_SIZE (16 * 1024)
+#endif
+
+// Largest object a slab allocator hands out
+#define SENSLAB_MAX_SIZE 512
+
+// 8 to 64 in steps of 8, then four classes per doubling, up to 512
+#define SENSLAB_CLASSES 20
+
+// Free objects hold the next free object
+struct senslab_free_object {
+  struct senslab_free_object *next;
+};
+
+struct senslab_class {
+  // most recently freed object of this class
+  struct senslab_free_object *free_objects;
+  // objects in this class's newest slab that have never been handed out
+  // are between these two
+  uintptr_t top;
+  uintptr_t end;
+  size_t object_size;
+};
+
+struct senslab_stats {
+  // slabs taken from the arena, across all size classes
+  size_t slabs;
+  // bytes taken from the arena
+  size_t slab_bytes;
+};
+
+struct senslab {
+  struct senslab_class classes[SENSLAB_CLASSES];
+  // slabs are allocated from here, and only freed along with it
+  struct senarena arena;
+  struct senslab_stats stats;
+};
+
+senmac_public struct senslab senslab_new(void);
+// Slabs come from an arena with this config, so they're carved out of its
+// chunks, with its backend or allocator. A chunk_size of 0 fits a few slabs.
+senmac_public struct senslab senslab_new_with_config(struct senarena_config config);
+#if defined(SENSLAB_NOINLINE) && !defined(SENSLAB_IMPL)
+// size has to be at most SENSLAB_MAX_SIZE.
+// Returns NULL if the arena's allocator failed.
+senmac_public void *senslab_alloc(struct senslab *restrict slab, size_t size) senslab_malloc;
+// size has to be the size ptr was allocated with
+senmac_public void senslab_dealloc(struct senslab *restrict slab, void *ptr, size_t size);
+#endif
+// Frees every slab, along with the objects in them
+senmac_public void senslab_free(struct senslab slab);
+senmac_public struct senslab_stats senslab_stats(const struct senslab *restrict slab);
+senmac_public void *senslab_alloc_more(struct senslab *restrict slab, struct senslab_class *restrict size_class);
+
+#define senslab_alloc_type(slab, type) senslab_alloc((slab), sizeof(type))
+#define senslab_dealloc_type(slab, ptr, type) senslab_dealloc((slab), (ptr), sizeof(type))
+
+#if defined(SENSLAB_IMPL) || !defined(SENSLAB_NOINLINE)
+
+#include <assert.h>
+
+static senslab_always_inline
+unsigned senslab_class_index(size_t size) {
+  assert(size <= SENSLAB_MAX_SIZE);
+  const size_t n = size == 0 ? 0 : size - 1;
+  if senslab_likely(n < 64) return n >> 3;
+  if (n < 128) return 4 + (n >> 4);
+  if (n < 256) return 8 + (n >> 5);
+  return 12 + (n >> 6);
+}
+
+#ifndef SENSLAB_IMPL
+extern senslab_always_inline
+#endif
+senslab_malloc
+void *senslab_alloc(struct senslab *restrict slab, size_t size) {
+  struct senslab_class *size_class = &slab->classes[senslab_class_index(size)];
+  struct senslab_free_object *res = size_class->free_objects;
+  if senslab_unlikely(res == NULL) {
+    return senslab_alloc_more(slab, size_class);
+  }
+  size_class->free_objects = res->next;
+  return res;
+}
+
+#ifndef SENSLAB_IMPL
+extern senslab_always_inline
+#endif
+void senslab_dealloc(struct senslab *restrict slab, void *ptr, size_t size) {
+  struct senslab_class *size_class = &slab->classes[senslab_class_index(size)];
+  struct senslab_free_object *object = (struct senslab_free_object*) ptr;
+  object->next = size_class->free_objects;
+  size_class->free_objects = object;
+}
+
+#endif // defined(SENSLAB_IMPL) || !defined(SENSLAB_NOINLINE)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ifndef SENSIBLE_SLAB_H
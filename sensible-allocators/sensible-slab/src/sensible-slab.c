@@ -0,0 +1,110 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "sensible-macros.h"
+#include "sensible-arena.h"
+
+#define SENSLAB_IMPL
+#include "../include/sensible-slab.h"
+#undef SENSLAB_IMPL
+
+// Every size class is a senpool-style free list, plus the untouched end
+// of that class's newest slab, which objects are carved out of, bottom to
+// top, the first time they're allocated.
+//
+// Slabs are allocated from an arena, so they're carved out of its chunks,
+// which come from its backend, its allocator, or the shared chunk pool.
+// They're only returned (to the arena) when the slab allocator is freed.
+//
+//   arena chunk
+//   ---------------------------------------------------------
+//   | free | slab (64 byte class) | slab (8 byte class) | ...
+//   ---------------------------------------------------------
+//
+//   slab
+//   -----------------------------------------------------
+//   | object | object | ... | untouched objects         |
+//   -----------------------------------------------------
+//                           ^                           ^
+//                           top                         end
+
+// Slabs are aligned like malloc, so that classes whose size is a multiple
+// of 16 get 16-byte aligned objects
+#define SENSLAB_SLAB_ALIGNMENT 16
+
+// Fits a few slabs, and the padding before them
+#define SENSLAB_DEFAULT_CHUNK_SIZE (8 * SENSLAB_SLAB_SIZE + SENSLAB_SLAB_ALIGNMENT)
+
+// The largest size that maps to class i
+static
+size_t senslab_class_size(unsigned i) {
+  if (i < 8) return 8 * (i + 1);
+  if (i < 12) return 64 + 16 * (i - 7);
+  if (i < 16) return 128 + 32 * (i - 11);
+  return 256 + 64 * (i - 15);
+}
+
+senmac_public
+struct senslab senslab_new_with_config(struct senarena_config config) {
+  if (config.chunk_size == 0) {
+    config.chunk_size = SENSLAB_DEFAULT_CHUNK_SIZE;
+  }
+  struct senslab res;
+  for (unsigned i = 0; i < SENSLAB_CLASSES; i++) {
+    struct senslab_class size_class = {
+      .free_objects = NULL,
+      .top = 0,
+      .end = 0,
+      .object_size = senslab_class_size(i),
+    };
+    assert(senslab_class_index(size_class.object_size) == i);
+    res.classes[i] = size_class;
+  }
+  res.arena = senarena_new_with_config(config);
+  res.stats.slabs = 0;
+  res.stats.slab_bytes = 0;
+  return res;
+}
+
+senmac_public
+struct senslab senslab_new(void) {
+  struct senarena_config config = {
+    .backend = SENARENA_BACKEND_MALLOC,
+    .huge_pages = false,
+    .chunk_size = 0,
+    .growth_factor = 1,
+    .max_chunk_size = 0,
+  };
+  return senslab_new_with_config(config);
+}
+
+senmac_public
+void *senslab_alloc_more(struct senslab *restrict slab, struct senslab_class *restrict size_class) {
+  if senslab_unlikely(size_class->end - size_class->top < size_class->object_size) {
+    void *new_slab = senarena_alloc(&slab->arena, SENSLAB_SLAB_SIZE, SENSLAB_SLAB_ALIGNMENT);
+    if senslab_unlikely(new_slab == NULL) return NULL;
+    size_class->top = (uintptr_t) new_slab;
+    size_class->end = (uintptr_t) new_slab + SENSLAB_SLAB_SIZE;
+    slab->stats.slabs++;
+    slab->stats.slab_bytes += SENSLAB_SLAB_SIZE;
+  }
+  void *res = (void*) size_class->top;
+  size_class->top += size_class->object_size;
+  return res;
+}
+
+senmac_public
+void senslab_free(struct senslab slab) {
+  senarena_free(slab.arena);
+}
+
+senmac_public
+struct senslab_stats senslab_stats(const struct senslab *restrict slab) {
+  return slab->stats;
+}
@@ -0,0 +1,199 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: CC0-1.0
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// glibc can tell us how much memory malloc holds, but not give back what
+// it held for a previous round, so each measurement runs in a child
+// process, with a fresh heap
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+# include <malloc.h>
+# include <sys/wait.h>
+# include <unistd.h>
+# define MEASURE_MALLOC_FOOTPRINT
+#endif
+
+#include "sensible-timing.h"
+#include "sensible-slab.h"
+
+#define ROUNDS 10
+#define OPERATIONS (16 * 1024 * 1024)
+
+// Object size ranges, like cache keys and values
+struct size_range {
+  size_t min;
+  size_t max;
+};
+
+static const struct size_range size_ranges[] = {{8, 64}, {8, 128}, {8, 512}};
+// Number of objects in the cache
+static const unsigned long slot_counts[] = {1024, 64 * 1024, 1024 * 1024};
+
+// The same pseudo-random operation sequence is replayed for each allocator
+static
+uint32_t next_random(uint32_t *state) {
+  // xorshift32
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static
+size_t random_size(uint32_t *state, struct size_range range) {
+  return range.min + next_random(state) % (range.max - range.min + 1);
+}
+
+// Size of the object in each slot
+static size_t *sizes;
+
+// A full cache, where each operation evicts a random entry, and replaces
+// it with one of a random size.
+// Leaves the cache full, and returns the time the evictions took.
+static
+uint64_t malloc_churn(volatile uint64_t **slots, unsigned long num_slots, struct size_range range) {
+  uint32_t random = 42;
+  for (unsigned long i = 0; i < num_slots; i++) {
+    sizes[i] = random_size(&random, range);
+    slots[i] = malloc(sizes[i]);
+    slots[i][0] = i;
+  }
+  const struct seninstant begin = seninstant_now();
+  for (unsigned long i = 0; i < OPERATIONS; i++) {
+    const unsigned long slot = next_random(&random) % num_slots;
+    free((void*) slots[slot]);
+    sizes[slot] = random_size(&random, range);
+    volatile uint64_t *obj = malloc(sizes[slot]);
+    obj[0] = i;
+    slots[slot] = obj;
+  }
+  return seninstant_subtract(seninstant_now(), begin);
+}
+
+static
+uint64_t slab_churn(struct senslab *restrict slab, volatile uint64_t **slots, unsigned long num_slots, struct size_range range) {
+  uint32_t random = 42;
+  for (unsigned long i = 0; i < num_slots; i++) {
+    sizes[i] = random_size(&random, range);
+    slots[i] = senslab_alloc(slab, sizes[i]);
+    slots[i][0] = i;
+  }
+  const struct seninstant begin = seninstant_now();
+  for (unsigned long i = 0; i < OPERATIONS; i++) {
+    const unsigned long slot = next_random(&random) % num_slots;
+    senslab_dealloc(slab, (void*) slots[slot], sizes[slot]);
+    sizes[slot] = random_size(&random, range);
+    volatile uint64_t *obj = senslab_alloc(slab, sizes[slot]);
+    obj[0] = i;
+    slots[slot] = obj;
+  }
+  return seninstant_subtract(seninstant_now(), begin);
+}
+
+static
+uint64_t malloc_round(volatile uint64_t **slots, unsigned long num_slots, struct size_range range) {
+  const uint64_t res = malloc_churn(slots, num_slots, range);
+  for (unsigned long i = 0; i < num_slots; i++) {
+    free((void*) slots[i]);
+    slots[i] = NULL;
+  }
+  return res;
+}
+
+static
+uint64_t slab_round(volatile uint64_t **slots, unsigned long num_slots, struct size_range range) {
+  struct senslab slab = senslab_new();
+  const uint64_t res = slab_churn(&slab, slots, num_slots, range);
+  senslab_free(slab);
+  memset((void*) slots, 0, sizeof(uint64_t*) * num_slots);
+  return res;
+}
+
+static
+uint64_t best_of(uint64_t (*round)(volatile uint64_t**, unsigned long, struct size_range), volatile uint64_t **slots, unsigned long num_slots, struct size_range range) {
+  uint64_t best = UINT64_MAX;
+  for (int i = 0; i < ROUNDS; i++) {
+    const uint64_t nanos = round(slots, num_slots, range);
+    if (nanos < best) best = nanos;
+  }
+  return best;
+}
+
+static
+size_t live_bytes(unsigned long num_slots) {
+  size_t res = 0;
+  for (unsigned long i = 0; i < num_slots; i++) {
+    res += sizes[i];
+  }
+  return res;
+}
+
+static
+void print_fragmentation(volatile uint64_t **slots, unsigned long num_slots, struct size_range range) {
+  struct senslab slab = senslab_new();
+  slab_churn(&slab, slots, num_slots, range);
+  const size_t live = live_bytes(num_slots);
+  printf("%3zu-%3zu bytes, %8lu slots: live %10zu, ", range.min, range.max, num_slots, live);
+#ifdef MEASURE_MALLOC_FOOTPRINT
+  fflush(stdout);
+  const pid_t child = fork();
+  if (child == 0) {
+    const struct mallinfo2 before = mallinfo2();
+    malloc_churn(slots, num_slots, range);
+    const struct mallinfo2 after = mallinfo2();
+    // free space malloc already had is held for the cache, too
+    const size_t footprint = (after.arena + after.hblkhd) - (before.uordblks + before.hblkhd);
+    printf("malloc %6.3f, ", (double) footprint / live);
+    fflush(stdout);
+    _exit(0);
+  }
+  waitpid(child, NULL, 0);
+#else
+  printf("malloc    n/a, ");
+#endif
+  printf("slab %6.3f\n", (double) senslab_stats(&slab).slab_bytes / live);
+  senslab_free(slab);
+  memset((void*) slots, 0, sizeof(uint64_t*) * num_slots);
+}
+
+int main(void) {
+  const size_t num_ranges = sizeof(size_ranges) / sizeof(size_ranges[0]);
+  const size_t num_slot_counts = sizeof(slot_counts) / sizeof(slot_counts[0]);
+  const unsigned long max_slots = slot_counts[num_slot_counts - 1];
+  volatile uint64_t **slots = calloc(max_slots, sizeof(uint64_t*));
+  sizes = calloc(max_slots, sizeof(size_t));
+
+  // before malloc has been churned in this process
+  puts("# Fragmentation after churn");
+  printf("%d evictions. Bytes held by the allocator, per live byte.\n\n", OPERATIONS);
+  for (size_t i = 0; i < num_ranges; i++) {
+    for (size_t j = 0; j < num_slot_counts; j++) {
+      print_fragmentation(slots, slot_counts[j], size_ranges[i]);
+    }
+  }
+
+  puts("\n# Cache churn throughput");
+  printf("%d evictions, best of %d rounds.\n\n", OPERATIONS, ROUNDS);
+  for (size_t i = 0; i < num_ranges; i++) {
+    for (size_t j = 0; j < num_slot_counts; j++) {
+      const uint64_t malloc_nanos = best_of(malloc_round, slots, slot_counts[j], size_ranges[i]);
+      const uint64_t slab_nanos = best_of(slab_round, slots, slot_counts[j], size_ranges[i]);
+      printf("%3zu-%3zu bytes, %8lu slots: malloc %8.3f ops/μs, slab %8.3f ops/μs, speedup %.3f\n",
+        size_ranges[i].min,
+        size_ranges[i].max,
+        slot_counts[j],
+        1000 * (double) OPERATIONS / malloc_nanos,
+        1000 * (double) OPERATIONS / slab_nanos,
+        (double) malloc_nanos / slab_nanos);
+    }
+  }
+  free(sizes);
+  free(slots);
+}
@@ -0,0 +1,26 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: CC0-1.0
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sensible-slab.h"
+
+struct entry {
+  uint64_t hash;
+  struct entry *next;
+};
+
+int main(void) {
+  struct senslab slab = senslab_new();
+  struct entry *a = senslab_alloc_type(&slab, struct entry);
+  char *key = senslab_alloc(&slab, 100);
+  strcpy(key, "some cached key");
+  a->hash = 42;
+  senslab_dealloc(&slab, key, 100);
+  senslab_dealloc_type(&slab, a, struct entry);
+  senslab_free(slab);
+  return 0;
+}
@@ -0,0 +1,171 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: CC0-1.0
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sensible-slab.h"
+#include "sensible-test.h"
+#include "sensible-macros.h"
+
+// Fails as many times as the int context says, then mallocs
+static
+void *flaky_alloc(void *context, size_t size) {
+  int *failures = context;
+  if (*failures > 0) {
+    (*failures)--;
+    return NULL;
+  }
+  return malloc(size);
+}
+
+static
+void flaky_free(void *context, void *ptr, size_t size) {
+  (void) context;
+  (void) size;
+  free(ptr);
+}
+
+senmac_public
+void run_sensible_slab_suite(struct sentest_state *state) {
+  sentest_group(state, "sensible-slab") {
+    sentest(state, "can be constructed and freed") {
+      struct senslab slab = senslab_new();
+      senslab_free(slab);
+    }
+    sentest(state, "size classes cover every size") {
+      struct senslab slab = senslab_new();
+      for (size_t size = 0; size <= SENSLAB_MAX_SIZE; size++) {
+        const size_t object_size = slab.classes[senslab_class_index(size)].object_size;
+        if (object_size < size || object_size < 8) {
+          sentest_failf(state, "size %zu maps to a class of %zu bytes", size, object_size);
+          break;
+        }
+      }
+      senslab_free(slab);
+    }
+    sentest(state, "size classes waste at most 7 bytes, or a quarter") {
+      struct senslab slab = senslab_new();
+      for (size_t size = 8; size <= SENSLAB_MAX_SIZE; size++) {
+        const size_t object_size = slab.classes[senslab_class_index(size)].object_size;
+        if (object_size - size > 7 && (object_size - size) * 4 > size) {
+          sentest_failf(state, "size %zu maps to a class of %zu bytes", size, object_size);
+          break;
+        }
+      }
+      senslab_free(slab);
+    }
+    sentest(state, "reuses the most recently freed object of a class") {
+      struct senslab slab = senslab_new();
+      void *a = senslab_alloc(&slab, 40);
+      void *b = senslab_alloc(&slab, 40);
+      void *c = senslab_alloc(&slab, 200);
+      sentest_assert_neq(state, a, b);
+      senslab_dealloc(&slab, a, 40);
+      senslab_dealloc(&slab, c, 200);
+      senslab_dealloc(&slab, b, 40);
+      // same class, different size
+      sentest_assert_eq(state, senslab_alloc(&slab, 33), b);
+      sentest_assert_eq(state, senslab_alloc(&slab, 40), a);
+      sentest_assert_eq(state, senslab_alloc(&slab, 200), c);
+      senslab_free(slab);
+    }
+    sentest(state, "aligns objects") {
+      struct senslab slab = senslab_new();
+      for (size_t size = 1; size <= SENSLAB_MAX_SIZE; size++) {
+        const size_t object_size = slab.classes[senslab_class_index(size)].object_size;
+        const uintptr_t alignment = object_size % 16 == 0 ? 16 : 8;
+        const uintptr_t ptr = (uintptr_t) senslab_alloc(&slab, size);
+        if (ptr % alignment != 0) {
+          sentest_failf(state, "%p isn't aligned to %zu", (void*) ptr, (size_t) alignment);
+          break;
+        }
+      }
+      senslab_free(slab);
+    }
+    sentest(state, "counts slabs") {
+      struct senslab slab = senslab_new();
+      sentest_assert_eq(state, senslab_stats(&slab).slabs, 0);
+      for (int i = 0; i < SENSLAB_SLAB_SIZE / 64; i++) {
+        senslab_alloc(&slab, 64);
+      }
+      sentest_assert_eq(state, senslab_stats(&slab).slabs, 1);
+      senslab_alloc(&slab, 64);
+      senslab_alloc(&slab, 8);
+      sentest_assert_eq(state, senslab_stats(&slab).slabs, 3);
+      sentest_assert_eq(state, senslab_stats(&slab).slab_bytes, 3 * SENSLAB_SLAB_SIZE);
+      senslab_free(slab);
+    }
+    sentest_group(state, "with a config") {
+      sentest(state, "can use the mmap backend") {
+        struct senarena_config config = {
+          .backend = SENARENA_BACKEND_MMAP,
+        };
+        struct senslab slab = senslab_new_with_config(config);
+        for (int i = 0; i < 100000; i++) {
+          memset(senslab_alloc(&slab, 100), 1, 100);
+        }
+        senslab_free(slab);
+      }
+      sentest(state, "returns NULL when the allocator fails") {
+        int failures = 2;
+        struct senarena_config config = {
+          .allocator = {
+            .alloc = flaky_alloc,
+            .free = flaky_free,
+            .context = &failures,
+          },
+        };
+        // the first chunk fails when the slab's made, and again here
+        struct senslab slab = senslab_new_with_config(config);
+        sentest_assert_eq(state, senslab_alloc(&slab, 16), NULL);
+        // and then the allocator recovers
+        volatile unsigned char *object = senslab_alloc(&slab, 16);
+        sentest_assert(state, object != NULL);
+        object[15] = 1;
+        sentest_assert_eq_fmt(state, "zu", (size_t) slab.stats.slabs, (size_t) 1);
+        senslab_free(slab);
+      }
+    }
+    sentest_group(state, "fuzz tests") {
+      // Randomly allocates and frees objects of random sizes, filled with
+      // their slot's number, checking that no object was overwritten
+      const int slots = 10000;
+      unsigned char **objects = calloc(slots, sizeof(unsigned char*));
+      size_t *sizes = calloc(slots, sizeof(size_t));
+      struct senslab slab = senslab_new();
+      bool intact = true;
+      for (int i = 0; i < 200000; i++) {
+        const int slot = rand() % slots;
+        if (objects[slot] == NULL) {
+          sizes[slot] = 1 + rand() % SENSLAB_MAX_SIZE;
+          objects[slot] = senslab_alloc(&slab, sizes[slot]);
+          memset(objects[slot], slot & 0xff, sizes[slot]);
+        } else {
+          unsigned char *object = objects[slot];
+          intact = intact && object[0] == (slot & 0xff) && object[sizes[slot] - 1] == (slot & 0xff);
+          senslab_dealloc(&slab, object, sizes[slot]);
+          objects[slot] = NULL;
+        }
+      }
+      sentest(state, "objects don't overlap") {
+        sentest_assert(state, intact);
+      }
+      sentest(state, "objects are intact at the end") {
+        for (int slot = 0; slot < slots; slot++) {
+          unsigned char *object = objects[slot];
+          if (object != NULL && object[sizes[slot] - 1] != (slot & 0xff)) {
+            sentest_failf(state, "slot %d holds %d", slot, object[sizes[slot] - 1]);
+            break;
+          }
+        }
+      }
+      senslab_free(slab);
+      free(sizes);
+      free(objects);
+    }
+  }
+}
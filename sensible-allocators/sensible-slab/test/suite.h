@@ -0,0 +1,21 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: CC0-1.0
+
+#ifndef SENSIBLE_SLAB_SUITE_H
+#define SENSIBLE_SLAB_SUITE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "sensible-test.h"
+#include "sensible-macros.h"
+
+senmac_public void run_sensible_slab_suite(struct sentest_state *state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
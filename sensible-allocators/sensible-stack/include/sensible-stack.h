@@ -0,0 +1,139 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef SENSIBLE_STACK_H
+#define SENSIBLE_STACK_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sensible-macros.h"
+
+// Double-ended stack allocator.
+// Allocates from both ends of one block, which never grows.
+// Frees allocations in LIFO order, separately at each end.
+
+#if defined(__GNUC__) || defined(__clang__)
+#define senstack_unlikely(x)     (__builtin_expect(!!(x),false))
+#define senstack_likely(x)       (__builtin_expect(!!(x),true))
+#elif (defined(__cplusplus) && (__cplusplus >= 202002L)) || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+#define senstack_unlikely(x)     (x) [[unlikely]]
+#define senstack_likely(x)       (x) [[likely]]
+#else
+#define senstack_unlikely(x)     (x)
+#define senstack_likely(x)       (x)
+#endif
+
+#define senstack_malloc
+#define senstack_always_inline inline
+
+#if defined(__has_attribute)
+# if __has_attribute(malloc)
+#  undef senstack_malloc
+#  define senstack_malloc __attribute__((__malloc__))
+# endif
+# if __has_attribute(always_inline)
+#  undef senstack_always_inline
+#  define senstack_always_inline inline __attribute__((__always_inline__))
+# endif
+#endif
+
+#define SENSTACK_SIMPLE_ALIGNOF(t) (sizeof(t) <= 1 ? 1 : offsetof(struct { char c; t x; }, x))
+#define SENSTACK_ALIGNOF(t) (sizeof(t) < SENSTACK_SIMPLE_ALIGNOF(t) ? sizeof(t) : SENSTACK_SIMPLE_ALIGNOF(t))
+
+struct senstack {
+  // first free byte, the low end grows up from begin
+  uintptr_t low;
+  // one past the last free byte, the high end grows down from end
+  uintptr_t high;
+  uintptr_t begin;
+  uintptr_t end;
+  // the block, if we allocated it, or NULL if it's the caller's
+  void *block;
+};
+
+// A position at one end of a stack
+struct senstack_mark {
+  uintptr_t position;
+};
+
+senmac_public struct senstack senstack_new(size_t capacity);
+// Allocates from buf, which has to outlive the stack, and is never freed
+senmac_public struct senstack senstack_new_with_buffer(void *buf, size_t len);
+#if defined(SENSTACK_NOINLINE) && !defined(SENSTACK_IMPL)
+// Returns NULL if the ends would meet
+senmac_public void *senstack_alloc_low(struct senstack *restrict stack, size_t amount, size_t alignment) senstack_malloc;
+senmac_public void *senstack_alloc_high(struct senstack *restrict stack, size_t amount, size_t alignment) senstack_malloc;
+#endif
+// Frees ptr, which was allocated from the low end, along with every
+// allocation made from the low end after it
+senmac_public void senstack_pop_low(struct senstack *restrict stack, void *ptr);
+// Frees ptr, an allocation of amount bytes from the high end, along with
+// every allocation made from the high end after it
+senmac_public void senstack_pop_high(struct senstack *restrict stack, void *ptr, size_t amount);
+// Rewinding to a mark frees everything allocated at that end since
+// the mark was taken, and invalidates marks taken after it
+senmac_public struct senstack_mark senstack_mark_low(const struct senstack *restrict stack);
+senmac_public struct senstack_mark senstack_mark_high(const struct senstack *restrict stack);
+senmac_public void senstack_rewind_low(struct senstack *restrict stack, struct senstack_mark mark);
+senmac_public void senstack_rewind_high(struct senstack *restrict stack, struct senstack_mark mark);
+// Bytes left between the two ends
+senmac_public size_t senstack_free_bytes(const struct senstack *restrict stack);
+// Frees everything, at both ends
+senmac_public void senstack_clear(struct senstack *restrict stack);
+senmac_public void senstack_free(struct senstack stack);
+
+#define senstack_alloc_low_type(stack, type) senstack_alloc_low((stack), sizeof(type), SENSTACK_ALIGNOF(type))
+#define senstack_alloc_high_type(stack, type) senstack_alloc_high((stack), sizeof(type), SENSTACK_ALIGNOF(type))
+
+#if defined(SENSTACK_IMPL) || !defined(SENSTACK_NOINLINE)
+
+#include <assert.h>
+
+#ifndef SENSTACK_IMPL
+extern senstack_always_inline
+#endif
+senstack_malloc
+void *senstack_alloc_low(struct senstack *restrict stack, size_t amount, size_t alignment) {
+  assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+  const uintptr_t start = (stack->low + alignment - 1) & -(uintptr_t) alignment;
+  // start can't wrap around, as long as the block doesn't end at the top
+  // of the address space
+  if senstack_unlikely(start > stack->high || amount > stack->high - start) {
+    return NULL;
+  }
+  stack->low = start + amount;
+  return (void*) start;
+}
+
+#ifndef SENSTACK_IMPL
+extern senstack_always_inline
+#endif
+senstack_malloc
+void *senstack_alloc_high(struct senstack *restrict stack, size_t amount, size_t alignment) {
+  assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+  if senstack_unlikely(amount > stack->high - stack->low) {
+    return NULL;
+  }
+  const uintptr_t start = (stack->high - amount) & -(uintptr_t) alignment;
+  if senstack_unlikely(start < stack->low) {
+    return NULL;
+  }
+  stack->high = start;
+  return (void*) start;
+}
+
+#endif // defined(SENSTACK_IMPL) || !defined(SENSTACK_NOINLINE)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ifndef SENSIBLE_STACK_H
@@ -0,0 +1,110 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <assert.h>
+#include <stdbool.h>
+// for perror
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "sensible-macros.h"
+
+#define SENSTACK_IMPL
+#include "../include/sensible-stack.h"
+#undef SENSTACK_IMPL
+
+// Both ends bump towards each other, in one block:
+//
+//   --------------------------------------------------------
+//   | low allocations -> |     free     | <- high allocations |
+//   --------------------------------------------------------
+//   ^                    ^              ^                     ^
+//   begin                low            high                  end
+//
+// Popping an allocation moves its end back to the allocation's start
+// (low end), or the allocation's end (high end). Any alignment padding
+// between it and the allocation before it comes back when that's popped.
+
+senmac_public
+struct senstack senstack_new_with_buffer(void *buf, size_t len) {
+  struct senstack res = {
+    .low = (uintptr_t) buf,
+    .high = (uintptr_t) buf + len,
+    .begin = (uintptr_t) buf,
+    .end = (uintptr_t) buf + len,
+    .block = NULL,
+  };
+  return res;
+}
+
+senmac_public
+struct senstack senstack_new(size_t capacity) {
+  void *block = malloc(capacity);
+  if (block == NULL) {
+    perror("Couldn't allocate stack block");
+    exit(1);
+  }
+  struct senstack res = senstack_new_with_buffer(block, capacity);
+  res.block = block;
+  return res;
+}
+
+senmac_public
+void senstack_pop_low(struct senstack *restrict stack, void *ptr) {
+  const uintptr_t position = (uintptr_t) ptr;
+  assert(position >= stack->begin && position <= stack->low);
+  stack->low = position;
+}
+
+senmac_public
+void senstack_pop_high(struct senstack *restrict stack, void *ptr, size_t amount) {
+  const uintptr_t position = (uintptr_t) ptr + amount;
+  assert((uintptr_t) ptr >= stack->high && position <= stack->end);
+  stack->high = position;
+}
+
+senmac_public
+struct senstack_mark senstack_mark_low(const struct senstack *restrict stack) {
+  struct senstack_mark res = {
+    .position = stack->low,
+  };
+  return res;
+}
+
+senmac_public
+struct senstack_mark senstack_mark_high(const struct senstack *restrict stack) {
+  struct senstack_mark res = {
+    .position = stack->high,
+  };
+  return res;
+}
+
+senmac_public
+void senstack_rewind_low(struct senstack *restrict stack, struct senstack_mark mark) {
+  assert(mark.position >= stack->begin && mark.position <= stack->low);
+  stack->low = mark.position;
+}
+
+senmac_public
+void senstack_rewind_high(struct senstack *restrict stack, struct senstack_mark mark) {
+  assert(mark.position >= stack->high && mark.position <= stack->end);
+  stack->high = mark.position;
+}
+
+senmac_public
+size_t senstack_free_bytes(const struct senstack *restrict stack) {
+  return stack->high - stack->low;
+}
+
+senmac_public
+void senstack_clear(struct senstack *restrict stack) {
+  stack->low = stack->begin;
+  stack->high = stack->end;
+}
+
+senmac_public
+void senstack_free(struct senstack stack) {
+  free(stack.block);
+}
@@ -0,0 +1,24 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: CC0-1.0
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "sensible-stack.h"
+
+int main(void) {
+  struct senstack stack = senstack_new(64 * 1024);
+  // results at the low end
+  int *results = senstack_alloc_low(&stack, sizeof(int) * 100, SENSTACK_ALIGNOF(int));
+  for (int i = 0; i < 100; i++) {
+    // scratch space at the high end
+    struct senstack_mark mark = senstack_mark_high(&stack);
+    int *scratch = senstack_alloc_high(&stack, sizeof(int) * 10, SENSTACK_ALIGNOF(int));
+    scratch[0] = i;
+    results[i] = scratch[0] * 2;
+    senstack_rewind_high(&stack, mark);
+  }
+  senstack_free(stack);
+  return 0;
+}
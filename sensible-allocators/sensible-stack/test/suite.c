@@ -0,0 +1,108 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: CC0-1.0
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sensible-stack.h"
+#include "sensible-test.h"
+#include "sensible-macros.h"
+
+senmac_public
+void run_sensible_stack_suite(struct sentest_state *state) {
+  sentest_group(state, "sensible-stack") {
+    sentest(state, "can be constructed and freed") {
+      struct senstack stack = senstack_new(1024);
+      senstack_free(stack);
+    }
+    sentest(state, "allocates upwards from the low end") {
+      struct senstack stack = senstack_new(1024);
+      unsigned char *a = senstack_alloc_low(&stack, 10, 1);
+      unsigned char *b = senstack_alloc_low(&stack, 10, 1);
+      sentest_assert_eq(state, a + 10, b);
+      senstack_free(stack);
+    }
+    sentest(state, "allocates downwards from the high end") {
+      struct senstack stack = senstack_new(1024);
+      unsigned char *a = senstack_alloc_high(&stack, 10, 1);
+      unsigned char *b = senstack_alloc_high(&stack, 10, 1);
+      sentest_assert_eq(state, b + 10, a);
+      senstack_free(stack);
+    }
+    sentest(state, "aligns both ends") {
+      struct senstack stack = senstack_new(64 * 1024);
+      const size_t alignments[] = {1, 2, 8, 16, 64, 256};
+      for (size_t i = 0; i < sizeof(alignments) / sizeof(alignments[0]); i++) {
+        const uintptr_t low = (uintptr_t) senstack_alloc_low(&stack, 3, alignments[i]);
+        const uintptr_t high = (uintptr_t) senstack_alloc_high(&stack, 3, alignments[i]);
+        sentest_assert_eq(state, low % alignments[i], 0);
+        sentest_assert_eq(state, high % alignments[i], 0);
+      }
+      senstack_free(stack);
+    }
+    sentest(state, "returns NULL when the ends would meet") {
+      struct senstack stack = senstack_new(100);
+      sentest_assert_neq(state, senstack_alloc_low(&stack, 60, 1), NULL);
+      sentest_assert_eq(state, senstack_alloc_high(&stack, 41, 1), NULL);
+      sentest_assert_neq(state, senstack_alloc_high(&stack, 40, 1), NULL);
+      sentest_assert_eq(state, senstack_alloc_low(&stack, 1, 1), NULL);
+      sentest_assert_eq(state, senstack_free_bytes(&stack), 0);
+      senstack_free(stack);
+    }
+    sentest(state, "pops allocations in LIFO order") {
+      struct senstack stack = senstack_new(1024);
+      void *a = senstack_alloc_low(&stack, 10, 1);
+      void *b = senstack_alloc_low(&stack, 20, 8);
+      void *c = senstack_alloc_high(&stack, 10, 1);
+      void *d = senstack_alloc_high(&stack, 20, 8);
+      senstack_pop_low(&stack, b);
+      sentest_assert_eq(state, senstack_alloc_low(&stack, 20, 8), b);
+      senstack_pop_low(&stack, b);
+      senstack_pop_high(&stack, d, 20);
+      sentest_assert_eq(state, senstack_alloc_high(&stack, 20, 8), d);
+      senstack_pop_high(&stack, d, 20);
+      senstack_pop_high(&stack, c, 10);
+      senstack_pop_low(&stack, a);
+      sentest_assert_eq(state, senstack_free_bytes(&stack), 1024);
+      senstack_free(stack);
+    }
+    sentest(state, "rewinds each end to a mark") {
+      struct senstack stack = senstack_new(1024);
+      senstack_alloc_low(&stack, 10, 1);
+      senstack_alloc_high(&stack, 10, 1);
+      const struct senstack_mark low = senstack_mark_low(&stack);
+      const struct senstack_mark high = senstack_mark_high(&stack);
+      const size_t free_bytes = senstack_free_bytes(&stack);
+      for (int i = 0; i < 10; i++) {
+        senstack_alloc_low(&stack, 10, 8);
+        senstack_alloc_high(&stack, 10, 8);
+      }
+      senstack_rewind_low(&stack, low);
+      sentest_assert_eq(state, stack.low, low.position);
+      sentest_assert(state, senstack_free_bytes(&stack) < free_bytes);
+      senstack_rewind_high(&stack, high);
+      sentest_assert_eq(state, senstack_free_bytes(&stack), free_bytes);
+      senstack_free(stack);
+    }
+    sentest(state, "clears both ends") {
+      struct senstack stack = senstack_new(1024);
+      senstack_alloc_low(&stack, 10, 1);
+      senstack_alloc_high(&stack, 10, 1);
+      senstack_clear(&stack);
+      sentest_assert_eq(state, senstack_free_bytes(&stack), 1024);
+      senstack_free(stack);
+    }
+    sentest(state, "works over a caller's buffer") {
+      unsigned char buf[256];
+      struct senstack stack = senstack_new_with_buffer(buf, sizeof(buf));
+      unsigned char *a = senstack_alloc_low(&stack, 10, 1);
+      unsigned char *b = senstack_alloc_high(&stack, 10, 1);
+      sentest_assert_eq(state, a, buf);
+      sentest_assert_eq(state, b, buf + sizeof(buf) - 10);
+      senstack_free(stack);
+    }
+  }
+}
@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef SENSIBLE_TLSF_H
+#define SENSIBLE_TLSF_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sensible-macros.h"
+#include "sensible-arena.h"
+
+// Two-Level Segregated Fit allocator.
+// Allocates and frees any size in O(1), unless it has to grow.
+// Frees objects individually.
+
+#define sentlsf_malloc
+
+#if defined(__has_attribute)
+# if __has_attribute(malloc)
+#  undef sentlsf_malloc
+#  define sentlsf_malloc __attribute__((__malloc__))
+# endif
+#endif
+
+// Every block's size is a multiple of this, and so is every pointer we return
+#define SENTLSF_ALIGNMENT 16
+
+// Free blocks are split into this many lists per power of two
+#define SENTLSF_SL_LOG2 4
+#define SENTLSF_SL_COUNT (1 << SENTLSF_SL_LOG2)
+
+// Blocks are smaller than 2^SENTLSF_FL_MAX bytes, so bigger regions are
+// only partially used
+#if SIZE_MAX > UINT32_MAX
+# define SENTLSF_FL_MAX 32
+#else
+# define SENTLSF_FL_MAX 30
+#endif
+// Blocks smaller than 2^SENTLSF_FL_SHIFT bytes all share the first level
+#define SENTLSF_FL_SHIFT (SENTLSF_SL_LOG2 + 4)
+#define SENTLSF_FL_COUNT (SENTLSF_FL_MAX - SENTLSF_FL_SHIFT + 1)
+
+// Largest allocation
+#define SENTLSF_MAX_SIZE (((size_t) 1 << (SENTLSF_FL_MAX - 1)) - SENTLSF_ALIGNMENT)
+
+#ifndef SENTLSF_DEFAULT_CHUNK_SIZE
+# define SENTLSF_DEFAULT_CHUNK_SIZE (1024 * 1024)
+#endif
+
+struct sentlsf_block {
+  // the block before this one in memory, or NULL
+  struct sentlsf_block *prev_phys;
+  // bytes after the header, with SENTLSF_BLOCK_* flags in the low bits
+  size_t size;
+  // the rest of the header is only valid for free blocks, and used blocks
+  // hold data here
+  struct sentlsf_block *next_free;
+  struct sentlsf_block *prev_free;
+};
+
+// Chunks we allocated, and have to free
+struct sentlsf_chunk {
+  struct sentlsf_chunk *next;
+  size_t size;
+};
+
+struct sentlsf_config {
+  // Bytes per chunk, including this allocator's bookkeeping
+  // (0 for SENTLSF_DEFAULT_CHUNK_SIZE)
+  size_t chunk_size;
+  // Supplies chunks instead of malloc, unless alloc is NULL.
+  // Allocations return NULL when alloc does, rather than exiting.
+  struct senarena_allocator allocator;
+};
+
+struct sentlsf {
+  // bit i is set if sl_bitmap[i] has any bits set
+  uint32_t fl_bitmap;
+  // bit j of sl_bitmap[i] is set if free_blocks[i][j] isn't empty
+  uint32_t sl_bitmap[SENTLSF_FL_COUNT];
+  struct sentlsf_block *free_blocks[SENTLSF_FL_COUNT][SENTLSF_SL_COUNT];
+  // newest chunk, the oldest of which holds this struct
+  struct sentlsf_chunk *chunks;
+  struct senarena_allocator allocator;
+  size_t chunk_size;
+  // false if the allocator only has the caller's buffer
+  bool grows;
+};
+
+// Lives inside buf, and only ever allocates from it (and regions added
+// later), so it never calls malloc. Returns NULL if buf is too small.
+senmac_public struct sentlsf *sentlsf_new_with_buffer(void *buf, size_t len);
+// Grows by a chunk at a time, when no free block fits.
+// Growing isn't O(1).
+senmac_public struct sentlsf *sentlsf_new(void);
+// Returns NULL if config's allocator fails
+senmac_public struct sentlsf *sentlsf_new_with_config(struct sentlsf_config config);
+// Adds a caller-owned region to allocate from, which has to outlive tlsf.
+// Returns false if it's too small.
+senmac_public bool sentlsf_add_region(struct sentlsf *restrict tlsf, void *buf, size_t len);
+// Returns NULL if no free block fits size, and the allocator can't grow
+senmac_public void *sentlsf_alloc(struct sentlsf *restrict tlsf, size_t size) sentlsf_malloc;
+senmac_public void sentlsf_dealloc(struct sentlsf *restrict tlsf, void *ptr);
+// Frees the chunks tlsf allocated, along with tlsf. Caller-provided
+// regions are left alone.
+senmac_public void sentlsf_free(struct sentlsf *tlsf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ifndef SENSIBLE_TLSF_H
@@ -0,0 +1,363 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <assert.h>
+#include <stdbool.h>
+// for perror
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+# include <intrin.h>
+#endif
+
+#include "sensible-macros.h"
+#include "../include/sensible-tlsf.h"
+
+// Free blocks are kept in size-segregated lists. The first level splits
+// sizes by power of two, and the second level splits each power of two
+// into SENTLSF_SL_COUNT linear ranges. A bitmap per level says which
+// lists are non-empty, so finding a block that fits is two bit scans.
+//
+// Every block has a header, which links it to the previous block in
+// memory, so that freeing can merge a block with both of its neighbours.
+// Every region ends with a used, empty sentinel block, so that no block
+// looks past the end of its region.
+//
+//   ------------------------------------------------------------------
+//   | header | data ... | header | data ...   | ... | header (empty) |
+//   ------------------------------------------------------------------
+//   ^                    ^
+//   prev_phys <--------- |
+
+#if defined(__GNUC__) || defined(__clang__)
+#define sentlsf_unlikely(x)     (__builtin_expect(!!(x),false))
+#define sentlsf_likely(x)       (__builtin_expect(!!(x),true))
+#else
+#define sentlsf_unlikely(x)     (x)
+#define sentlsf_likely(x)       (x)
+#endif
+
+#define SENTLSF_BLOCK_FREE ((size_t) 1)
+#define SENTLSF_BLOCK_PREV_FREE ((size_t) 2)
+#define SENTLSF_BLOCK_FLAGS (SENTLSF_BLOCK_FREE | SENTLSF_BLOCK_PREV_FREE)
+
+// Used blocks' data starts at next_free
+#define SENTLSF_BLOCK_HEADER_SIZE offsetof(struct sentlsf_block, next_free)
+// Free blocks have to fit the free list links
+#define SENTLSF_MIN_BLOCK_SIZE (sizeof(struct sentlsf_block) - SENTLSF_BLOCK_HEADER_SIZE)
+#define SENTLSF_MAX_BLOCK_SIZE (((size_t) 1 << SENTLSF_FL_MAX) - SENTLSF_ALIGNMENT)
+#define SENTLSF_SMALL_BLOCK_SIZE ((size_t) 1 << SENTLSF_FL_SHIFT)
+
+// The smallest region that fits a block, and a sentinel
+#define SENTLSF_MIN_REGION_SIZE (2 * SENTLSF_BLOCK_HEADER_SIZE + SENTLSF_MIN_BLOCK_SIZE)
+
+static
+size_t sentlsf_align_up(size_t n, size_t alignment) {
+  return (n + alignment - 1) & ~(alignment - 1);
+}
+
+// Index of the lowest set bit. x can't be zero.
+static
+unsigned sentlsf_ffs(uint32_t x) {
+  assert(x != 0);
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctz(x);
+#elif defined(_MSC_VER)
+  unsigned long res;
+  _BitScanForward(&res, x);
+  return res;
+#else
+  unsigned res = 0;
+  while ((x & 1) == 0) {
+    x >>= 1;
+    res++;
+  }
+  return res;
+#endif
+}
+
+// Index of the highest set bit. x can't be zero.
+static
+unsigned sentlsf_fls(size_t x) {
+  assert(x != 0);
+#if defined(__GNUC__) || defined(__clang__)
+  return sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(x);
+#elif defined(_MSC_VER) && defined(_WIN64)
+  unsigned long res;
+  _BitScanReverse64(&res, x);
+  return res;
+#elif defined(_MSC_VER)
+  unsigned long res;
+  _BitScanReverse(&res, x);
+  return res;
+#else
+  unsigned res = 0;
+  while (x >>= 1) {
+    res++;
+  }
+  return res;
+#endif
+}
+
+static
+size_t sentlsf_block_size(const struct sentlsf_block *block) {
+  return block->size & ~SENTLSF_BLOCK_FLAGS;
+}
+
+static
+void *sentlsf_block_data(struct sentlsf_block *block) {
+  return (unsigned char*) block + SENTLSF_BLOCK_HEADER_SIZE;
+}
+
+static
+struct sentlsf_block *sentlsf_block_from_data(void *ptr) {
+  return (struct sentlsf_block*) ((unsigned char*) ptr - SENTLSF_BLOCK_HEADER_SIZE);
+}
+
+static
+struct sentlsf_block *sentlsf_next_phys(struct sentlsf_block *block) {
+  return (struct sentlsf_block*) ((unsigned char*) sentlsf_block_data(block) + sentlsf_block_size(block));
+}
+
+// The list a block of this size belongs in
+static
+void sentlsf_mapping_insert(size_t size, unsigned *fl, unsigned *sl) {
+  if (size < SENTLSF_SMALL_BLOCK_SIZE) {
+    *fl = 0;
+    *sl = size / (SENTLSF_SMALL_BLOCK_SIZE / SENTLSF_SL_COUNT);
+  } else {
+    const unsigned bit = sentlsf_fls(size);
+    *sl = (size >> (bit - SENTLSF_SL_LOG2)) ^ SENTLSF_SL_COUNT;
+    *fl = bit - (SENTLSF_FL_SHIFT - 1);
+  }
+}
+
+// The first list whose blocks are all at least this big
+static
+void sentlsf_mapping_search(size_t size, unsigned *fl, unsigned *sl) {
+  if (size >= SENTLSF_SMALL_BLOCK_SIZE) {
+    size += ((size_t) 1 << (sentlsf_fls(size) - SENTLSF_SL_LOG2)) - 1;
+  }
+  sentlsf_mapping_insert(size, fl, sl);
+}
+
+static
+void sentlsf_insert_free(struct sentlsf *restrict tlsf, struct sentlsf_block *block) {
+  unsigned fl, sl;
+  sentlsf_mapping_insert(sentlsf_block_size(block), &fl, &sl);
+  struct sentlsf_block *head = tlsf->free_blocks[fl][sl];
+  block->next_free = head;
+  block->prev_free = NULL;
+  if (head != NULL) head->prev_free = block;
+  tlsf->free_blocks[fl][sl] = block;
+  tlsf->fl_bitmap |= (uint32_t) 1 << fl;
+  tlsf->sl_bitmap[fl] |= (uint32_t) 1 << sl;
+}
+
+static
+void sentlsf_remove_free(struct sentlsf *restrict tlsf, struct sentlsf_block *block) {
+  struct sentlsf_block *next = block->next_free;
+  struct sentlsf_block *prev = block->prev_free;
+  if (next != NULL) next->prev_free = prev;
+  if (prev != NULL) {
+    prev->next_free = next;
+    return;
+  }
+  unsigned fl, sl;
+  sentlsf_mapping_insert(sentlsf_block_size(block), &fl, &sl);
+  tlsf->free_blocks[fl][sl] = next;
+  if (next == NULL) {
+    tlsf->sl_bitmap[fl] &= ~((uint32_t) 1 << sl);
+    if (tlsf->sl_bitmap[fl] == 0) {
+      tlsf->fl_bitmap &= ~((uint32_t) 1 << fl);
+    }
+  }
+}
+
+// Returns a free block of at least size bytes, or NULL
+static
+struct sentlsf_block *sentlsf_find_free(struct sentlsf *restrict tlsf, size_t size) {
+  unsigned fl, sl;
+  sentlsf_mapping_search(size, &fl, &sl);
+  if sentlsf_unlikely(fl >= SENTLSF_FL_COUNT) return NULL;
+  uint32_t sl_map = tlsf->sl_bitmap[fl] & (~(uint32_t) 0 << sl);
+  if (sl_map == 0) {
+    const uint32_t fl_map = tlsf->fl_bitmap & (~(uint32_t) 0 << (fl + 1));
+    if (fl_map == 0) return NULL;
+    fl = sentlsf_ffs(fl_map);
+    sl_map = tlsf->sl_bitmap[fl];
+  }
+  return tlsf->free_blocks[fl][sentlsf_ffs(sl_map)];
+}
+
+senmac_public
+bool sentlsf_add_region(struct sentlsf *restrict tlsf, void *buf, size_t len) {
+  const uintptr_t start = sentlsf_align_up((uintptr_t) buf, SENTLSF_ALIGNMENT);
+  const uintptr_t end = ((uintptr_t) buf + len) & ~((uintptr_t) SENTLSF_ALIGNMENT - 1);
+  if (buf == NULL || end < start || end - start < SENTLSF_MIN_REGION_SIZE) return false;
+  size_t size = end - start - 2 * SENTLSF_BLOCK_HEADER_SIZE;
+  if (size > SENTLSF_MAX_BLOCK_SIZE) size = SENTLSF_MAX_BLOCK_SIZE;
+  struct sentlsf_block *block = (struct sentlsf_block*) start;
+  block->prev_phys = NULL;
+  block->size = size | SENTLSF_BLOCK_FREE;
+  struct sentlsf_block *sentinel = sentlsf_next_phys(block);
+  sentinel->prev_phys = block;
+  sentinel->size = SENTLSF_BLOCK_PREV_FREE;
+  sentlsf_insert_free(tlsf, block);
+  return true;
+}
+
+static
+void sentlsf_init(struct sentlsf *restrict tlsf) {
+  memset(tlsf, 0, sizeof(struct sentlsf));
+}
+
+senmac_public
+struct sentlsf *sentlsf_new_with_buffer(void *buf, size_t len) {
+  const uintptr_t start = sentlsf_align_up((uintptr_t) buf, SENTLSF_ALIGNMENT);
+  const uintptr_t regions = start + sentlsf_align_up(sizeof(struct sentlsf), SENTLSF_ALIGNMENT);
+  if (buf == NULL || regions > (uintptr_t) buf + len) return NULL;
+  struct sentlsf *res = (struct sentlsf*) start;
+  sentlsf_init(res);
+  if (!sentlsf_add_region(res, (void*) regions, (uintptr_t) buf + len - regions)) return NULL;
+  return res;
+}
+
+// Returns NULL if the allocator failed
+static
+struct sentlsf_chunk *sentlsf_chunk_new(const struct senarena_allocator *restrict allocator, size_t size) {
+  struct sentlsf_chunk *chunk;
+  if (allocator->alloc != NULL) {
+    chunk = (struct sentlsf_chunk*) allocator->alloc(allocator->context, size);
+    if (chunk == NULL) return NULL;
+  } else {
+    chunk = (struct sentlsf_chunk*) malloc(size);
+    if (chunk == NULL) {
+      perror("Couldn't allocate tlsf chunk");
+      exit(1);
+    }
+  }
+  chunk->next = NULL;
+  chunk->size = size;
+  return chunk;
+}
+
+#define SENTLSF_CHUNK_HEADER_SIZE sentlsf_align_up(sizeof(struct sentlsf_chunk), SENTLSF_ALIGNMENT)
+
+senmac_public
+struct sentlsf *sentlsf_new_with_config(struct sentlsf_config config) {
+  const size_t min_size = SENTLSF_CHUNK_HEADER_SIZE
+    + sentlsf_align_up(sizeof(struct sentlsf), SENTLSF_ALIGNMENT)
+    + SENTLSF_MIN_REGION_SIZE
+    + SENTLSF_ALIGNMENT;
+  size_t chunk_size = config.chunk_size == 0 ? SENTLSF_DEFAULT_CHUNK_SIZE : config.chunk_size;
+  if (chunk_size < min_size) chunk_size = min_size;
+  struct sentlsf_chunk *chunk = sentlsf_chunk_new(&config.allocator, chunk_size);
+  if (chunk == NULL) return NULL;
+  struct sentlsf *res = sentlsf_new_with_buffer((unsigned char*) chunk + SENTLSF_CHUNK_HEADER_SIZE, chunk_size - SENTLSF_CHUNK_HEADER_SIZE);
+  res->chunks = chunk;
+  res->allocator = config.allocator;
+  res->chunk_size = chunk_size;
+  res->grows = true;
+  return res;
+}
+
+senmac_public
+struct sentlsf *sentlsf_new(void) {
+  struct sentlsf_config config = {
+    .chunk_size = 0,
+    .allocator = {
+      .alloc = NULL,
+      .free = NULL,
+      .context = NULL,
+    },
+  };
+  return sentlsf_new_with_config(config);
+}
+
+// Adds a chunk with a free block of at least size bytes
+static
+bool sentlsf_grow(struct sentlsf *restrict tlsf, size_t size) {
+  // a block this big is in a list that mapping_search will look in, even
+  // after aligning the region
+  const size_t block_size = size + (size >> SENTLSF_SL_LOG2) + 2 * SENTLSF_ALIGNMENT;
+  size_t chunk_size = SENTLSF_CHUNK_HEADER_SIZE + 2 * SENTLSF_BLOCK_HEADER_SIZE + block_size;
+  if (chunk_size < tlsf->chunk_size) chunk_size = tlsf->chunk_size;
+  struct sentlsf_chunk *chunk = sentlsf_chunk_new(&tlsf->allocator, chunk_size);
+  if (chunk == NULL) return false;
+  chunk->next = tlsf->chunks;
+  tlsf->chunks = chunk;
+  return sentlsf_add_region(tlsf, (unsigned char*) chunk + SENTLSF_CHUNK_HEADER_SIZE, chunk_size - SENTLSF_CHUNK_HEADER_SIZE);
+}
+
+senmac_public
+void *sentlsf_alloc(struct sentlsf *restrict tlsf, size_t size) {
+  if sentlsf_unlikely(size > SENTLSF_MAX_SIZE) return NULL;
+  size = size < SENTLSF_MIN_BLOCK_SIZE ? SENTLSF_MIN_BLOCK_SIZE : sentlsf_align_up(size, SENTLSF_ALIGNMENT);
+  struct sentlsf_block *block = sentlsf_find_free(tlsf, size);
+  if sentlsf_unlikely(block == NULL) {
+    if (!tlsf->grows || !sentlsf_grow(tlsf, size)) return NULL;
+    block = sentlsf_find_free(tlsf, size);
+    assert(block != NULL);
+  }
+  sentlsf_remove_free(tlsf, block);
+
+  const size_t block_size = sentlsf_block_size(block);
+  struct sentlsf_block *next = sentlsf_next_phys(block);
+  if (block_size - size >= SENTLSF_BLOCK_HEADER_SIZE + SENTLSF_MIN_BLOCK_SIZE) {
+    // give the rest back
+    struct sentlsf_block *rest = (struct sentlsf_block*) ((unsigned char*) sentlsf_block_data(block) + size);
+    rest->prev_phys = block;
+    rest->size = (block_size - size - SENTLSF_BLOCK_HEADER_SIZE) | SENTLSF_BLOCK_FREE;
+    next->prev_phys = rest;
+    block->size = size | (block->size & SENTLSF_BLOCK_PREV_FREE);
+    sentlsf_insert_free(tlsf, rest);
+  } else {
+    block->size &= ~SENTLSF_BLOCK_FREE;
+    next->size &= ~SENTLSF_BLOCK_PREV_FREE;
+  }
+  return sentlsf_block_data(block);
+}
+
+senmac_public
+void sentlsf_dealloc(struct sentlsf *restrict tlsf, void *ptr) {
+  if (ptr == NULL) return;
+  struct sentlsf_block *block = sentlsf_block_from_data(ptr);
+  assert(!(block->size & SENTLSF_BLOCK_FREE));
+  block->size |= SENTLSF_BLOCK_FREE;
+  if (block->size & SENTLSF_BLOCK_PREV_FREE) {
+    struct sentlsf_block *prev = block->prev_phys;
+    sentlsf_remove_free(tlsf, prev);
+    prev->size += SENTLSF_BLOCK_HEADER_SIZE + sentlsf_block_size(block);
+    block = prev;
+  }
+  struct sentlsf_block *next = sentlsf_next_phys(block);
+  if (next->size & SENTLSF_BLOCK_FREE) {
+    sentlsf_remove_free(tlsf, next);
+    block->size += SENTLSF_BLOCK_HEADER_SIZE + sentlsf_block_size(next);
+    next = sentlsf_next_phys(block);
+  }
+  next->prev_phys = block;
+  next->size |= SENTLSF_BLOCK_PREV_FREE;
+  sentlsf_insert_free(tlsf, block);
+}
+
+senmac_public
+void sentlsf_free(struct sentlsf *tlsf) {
+  // the last chunk holds tlsf, so we can't read it after freeing that
+  const struct senarena_allocator allocator = tlsf->allocator;
+  struct sentlsf_chunk *chunk = tlsf->chunks;
+  while (chunk != NULL) {
+    struct sentlsf_chunk *next = chunk->next;
+    if (allocator.alloc == NULL) {
+      free(chunk);
+    } else if (allocator.free != NULL) {
+      allocator.free(allocator.context, chunk, chunk->size);
+    }
+    chunk = next;
+  }
+}
@@ -0,0 +1,140 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: CC0-1.0
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sensible-timing.h"
+#include "sensible-tlsf.h"
+
+#define OPERATIONS (4 * 1024 * 1024)
+#define TLSF_BUFFER_SIZE (256 * 1024 * 1024)
+
+// Largest allocation, sizes are spread evenly over powers of two below it
+static const size_t max_sizes[] = {256, 4096, 64 * 1024};
+// Numbers of allocations that can be live at once
+static const unsigned long slot_counts[] = {1024, 16 * 1024};
+
+// The same pseudo-random operation sequence is replayed for each allocator
+static
+uint32_t next_random(uint32_t *state) {
+  // xorshift32
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static
+size_t random_size(uint32_t *state, size_t max_size) {
+  const size_t power = (size_t) 16 << (next_random(state) % 13);
+  const size_t bound = power < max_size ? power : max_size;
+  return 1 + next_random(state) % bound;
+}
+
+// Nanoseconds each allocation took
+static uint64_t *latencies;
+
+// Each operation picks a random slot, and frees its allocation if it has
+// one, otherwise allocates, timing each allocation on its own.
+// Returns the number of allocations.
+static
+size_t malloc_round(void **slots, unsigned long num_slots, size_t max_size) {
+  uint32_t random = 42;
+  size_t allocations = 0;
+  for (unsigned long i = 0; i < OPERATIONS; i++) {
+    const unsigned long slot = next_random(&random) % num_slots;
+    if (slots[slot] == NULL) {
+      const size_t size = random_size(&random, max_size);
+      const struct seninstant begin = seninstant_now();
+      unsigned char *ptr = malloc(size);
+      latencies[allocations++] = seninstant_subtract(seninstant_now(), begin);
+      ptr[0] = 1;
+      slots[slot] = ptr;
+    } else {
+      free(slots[slot]);
+      slots[slot] = NULL;
+    }
+  }
+  for (unsigned long i = 0; i < num_slots; i++) {
+    free(slots[i]);
+    slots[i] = NULL;
+  }
+  return allocations;
+}
+
+static
+size_t tlsf_round(void **slots, unsigned long num_slots, size_t max_size, struct sentlsf *restrict tlsf) {
+  uint32_t random = 42;
+  size_t allocations = 0;
+  for (unsigned long i = 0; i < OPERATIONS; i++) {
+    const unsigned long slot = next_random(&random) % num_slots;
+    if (slots[slot] == NULL) {
+      const size_t size = random_size(&random, max_size);
+      const struct seninstant begin = seninstant_now();
+      unsigned char *ptr = sentlsf_alloc(tlsf, size);
+      latencies[allocations++] = seninstant_subtract(seninstant_now(), begin);
+      ptr[0] = 1;
+      slots[slot] = ptr;
+    } else {
+      sentlsf_dealloc(tlsf, slots[slot]);
+      slots[slot] = NULL;
+    }
+  }
+  for (unsigned long i = 0; i < num_slots; i++) {
+    sentlsf_dealloc(tlsf, slots[i]);
+    slots[i] = NULL;
+  }
+  return allocations;
+}
+
+static
+int compare_u64(const void *a, const void *b) {
+  const uint64_t x = *(const uint64_t*) a;
+  const uint64_t y = *(const uint64_t*) b;
+  return (x > y) - (x < y);
+}
+
+static
+void print_percentiles(const char *name, size_t allocations) {
+  qsort(latencies, allocations, sizeof(uint64_t), compare_u64);
+  printf("  %-6s p50 %6" PRIu64 "ns, p99 %6" PRIu64 "ns, p99.9 %6" PRIu64 "ns, max %8" PRIu64 "ns\n",
+    name,
+    latencies[allocations / 2],
+    latencies[allocations / 100 * 99],
+    latencies[allocations / 1000 * 999],
+    latencies[allocations - 1]);
+}
+
+int main(void) {
+  const unsigned long max_slots = slot_counts[sizeof(slot_counts) / sizeof(slot_counts[0]) - 1];
+  void **slots = calloc(max_slots, sizeof(void*));
+  latencies = calloc(OPERATIONS, sizeof(uint64_t));
+  // touch every page up front, like a latency-critical thread would
+  unsigned char *buf = malloc(TLSF_BUFFER_SIZE);
+  memset(buf, 0, TLSF_BUFFER_SIZE);
+  struct sentlsf *tlsf = sentlsf_new_with_buffer(buf, TLSF_BUFFER_SIZE);
+
+  puts("# Allocation latency");
+  printf("%d random allocs and frees, latency of the second of two identical runs.\n", OPERATIONS);
+  for (size_t i = 0; i < sizeof(max_sizes) / sizeof(max_sizes[0]); i++) {
+    for (size_t j = 0; j < sizeof(slot_counts) / sizeof(slot_counts[0]); j++) {
+      printf("\nup to %zu bytes, %lu slots:\n", max_sizes[i], slot_counts[j]);
+      // the first run warms up the heap
+      malloc_round(slots, slot_counts[j], max_sizes[i]);
+      print_percentiles("malloc", malloc_round(slots, slot_counts[j], max_sizes[i]));
+      tlsf_round(slots, slot_counts[j], max_sizes[i], tlsf);
+      print_percentiles("tlsf", tlsf_round(slots, slot_counts[j], max_sizes[i], tlsf));
+    }
+  }
+  sentlsf_free(tlsf);
+  free(buf);
+  free(latencies);
+  free(slots);
+}
@@ -0,0 +1,24 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: CC0-1.0
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sensible-tlsf.h"
+
+static unsigned char memory[1024 * 1024];
+
+int main(void) {
+  // never touches malloc
+  struct sentlsf *tlsf = sentlsf_new_with_buffer(memory, sizeof(memory));
+  char *message = sentlsf_alloc(tlsf, 100);
+  strcpy(message, "hello");
+  uint64_t *numbers = sentlsf_alloc(tlsf, sizeof(uint64_t) * 1000);
+  numbers[999] = 42;
+  sentlsf_dealloc(tlsf, message);
+  sentlsf_dealloc(tlsf, numbers);
+  sentlsf_free(tlsf);
+  return 0;
+}
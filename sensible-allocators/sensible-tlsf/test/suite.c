@@ -0,0 +1,195 @@
+// SPDX-FileCopyrightText: 2023 The libsensible Authors
+//
+// SPDX-License-Identifier: CC0-1.0
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sensible-tlsf.h"
+#include "sensible-test.h"
+#include "sensible-macros.h"
+
+static
+void *failing_alloc(void *context, size_t size) {
+  (void) context;
+  (void) size;
+  return NULL;
+}
+
+struct counting_allocator {
+  size_t live_chunks;
+};
+
+static
+void *counting_alloc(void *context, size_t size) {
+  ((struct counting_allocator*) context)->live_chunks++;
+  return malloc(size);
+}
+
+static
+void counting_free(void *context, void *ptr, size_t size) {
+  (void) size;
+  ((struct counting_allocator*) context)->live_chunks--;
+  free(ptr);
+}
+
+senmac_public
+void run_sensible_tlsf_suite(struct sentest_state *state) {
+  sentest_group(state, "sensible-tlsf") {
+    sentest(state, "can be constructed and freed") {
+      struct sentlsf *tlsf = sentlsf_new();
+      sentlsf_free(tlsf);
+    }
+    sentest(state, "aligns allocations") {
+      struct sentlsf *tlsf = sentlsf_new();
+      for (size_t size = 0; size < 2000; size++) {
+        const uintptr_t ptr = (uintptr_t) sentlsf_alloc(tlsf, size);
+        if (ptr % SENTLSF_ALIGNMENT != 0) {
+          sentest_failf(state, "%p isn't aligned", (void*) ptr);
+          break;
+        }
+      }
+      sentlsf_free(tlsf);
+    }
+    sentest(state, "ignores NULL") {
+      struct sentlsf *tlsf = sentlsf_new();
+      sentlsf_dealloc(tlsf, NULL);
+      sentlsf_free(tlsf);
+    }
+    sentest(state, "rejects allocations that are too big") {
+      struct sentlsf *tlsf = sentlsf_new();
+      sentest_assert_eq(state, sentlsf_alloc(tlsf, SENTLSF_MAX_SIZE + 1), NULL);
+      sentlsf_free(tlsf);
+    }
+    sentest(state, "grows to fit allocations bigger than a chunk") {
+      struct sentlsf *tlsf = sentlsf_new();
+      unsigned char *a = sentlsf_alloc(tlsf, SENTLSF_DEFAULT_CHUNK_SIZE * 3);
+      sentest_assert_neq(state, a, NULL);
+      memset(a, 1, SENTLSF_DEFAULT_CHUNK_SIZE * 3);
+      sentlsf_free(tlsf);
+    }
+    sentest_group(state, "with a buffer") {
+      static unsigned char buf[64 * 1024];
+      sentest(state, "is NULL if the buffer is too small") {
+        sentest_assert_eq(state, sentlsf_new_with_buffer(buf, 16), NULL);
+      }
+      sentest(state, "returns NULL once the buffer is full") {
+        struct sentlsf *tlsf = sentlsf_new_with_buffer(buf, sizeof(buf));
+        int allocations = 0;
+        while (sentlsf_alloc(tlsf, 1000) != NULL) {
+          allocations++;
+        }
+        sentest_assert(state, allocations > 0);
+        sentest_assert(state, allocations < (int) sizeof(buf) / 1000);
+        sentlsf_free(tlsf);
+      }
+      sentest(state, "merges freed neighbours") {
+        struct sentlsf *tlsf = sentlsf_new_with_buffer(buf, sizeof(buf));
+        void *whole = sentlsf_alloc(tlsf, 40 * 1024);
+        sentest_assert_neq(state, whole, NULL);
+        sentlsf_dealloc(tlsf, whole);
+        void *parts[40];
+        for (int i = 0; i < 40; i++) {
+          parts[i] = sentlsf_alloc(tlsf, 1000);
+        }
+        // free them out of order, so both neighbours get merged
+        for (int i = 0; i < 40; i += 2) {
+          sentlsf_dealloc(tlsf, parts[i]);
+        }
+        for (int i = 1; i < 40; i += 2) {
+          sentlsf_dealloc(tlsf, parts[i]);
+        }
+        sentest_assert_eq(state, sentlsf_alloc(tlsf, 40 * 1024), whole);
+        sentlsf_free(tlsf);
+      }
+      sentest(state, "allocates from added regions") {
+        static unsigned char region[8 * 1024];
+        struct sentlsf *tlsf = sentlsf_new_with_buffer(buf, sizeof(buf));
+        while (sentlsf_alloc(tlsf, 1000) != NULL) {}
+        sentest_assert(state, sentlsf_add_region(tlsf, region, sizeof(region)));
+        unsigned char *a = sentlsf_alloc(tlsf, 1000);
+        sentest_assert(state, a >= region && a < region + sizeof(region));
+        sentlsf_free(tlsf);
+      }
+    }
+    sentest_group(state, "with an allocator") {
+      sentest(state, "is NULL when the allocator fails") {
+        struct sentlsf_config config = {
+          .allocator = {
+            .alloc = failing_alloc,
+            .free = NULL,
+            .context = NULL,
+          },
+        };
+        sentest_assert_eq(state, sentlsf_new_with_config(config), NULL);
+      }
+      sentest(state, "gives back every chunk") {
+        struct counting_allocator counter = {0};
+        struct sentlsf_config config = {
+          .chunk_size = 4096,
+          .allocator = {
+            .alloc = counting_alloc,
+            .free = counting_free,
+            .context = &counter,
+          },
+        };
+        struct sentlsf *tlsf = sentlsf_new_with_config(config);
+        for (int i = 0; i < 100; i++) {
+          sentlsf_alloc(tlsf, 1000);
+        }
+        sentest_assert(state, counter.live_chunks > 1);
+        sentlsf_free(tlsf);
+        sentest_assert_eq(state, counter.live_chunks, 0);
+      }
+    }
+    sentest_group(state, "fuzz tests") {
+      // Randomly allocates and frees objects of random sizes, filled with
+      // their slot's number, checking that no object was overwritten
+      const int slots = 5000;
+      unsigned char **objects = calloc(slots, sizeof(unsigned char*));
+      size_t *sizes = calloc(slots, sizeof(size_t));
+      struct sentlsf *tlsf = sentlsf_new();
+      bool intact = true;
+      for (int i = 0; i < 200000; i++) {
+        const int slot = rand() % slots;
+        if (objects[slot] == NULL) {
+          // mostly small, sometimes big
+          sizes[slot] = 1 + (rand() % 8 == 0 ? rand() % 20000 : rand() % 300);
+          objects[slot] = sentlsf_alloc(tlsf, sizes[slot]);
+          memset(objects[slot], slot & 0xff, sizes[slot]);
+        } else {
+          unsigned char *object = objects[slot];
+          intact = intact && object[0] == (slot & 0xff) && object[sizes[slot] - 1] == (slot & 0xff);
+          sentlsf_dealloc(tlsf, object);
+          objects[slot] = NULL;
+        }
+      }
+      sentest(state, "objects don't overlap") {
+        sentest_assert(state, intact);
+      }
+      sentest(state, "objects are intact at the end") {
+        for (int slot = 0; slot < slots; slot++) {
+          unsigned char *object = objects[slot];
+          if (object != NULL && object[sizes[slot] - 1] != (slot & 0xff)) {
+            sentest_failf(state, "slot %d holds %d", slot, object[sizes[slot] - 1]);
+            break;
+          }
+        }
+      }
+      sentest(state, "freeing everything merges each chunk back together") {
+        for (int slot = 0; slot < slots; slot++) {
+          sentlsf_dealloc(tlsf, objects[slot]);
+        }
+        // so a big allocation fits in an existing chunk
+        struct sentlsf_chunk *chunks = tlsf->chunks;
+        sentest_assert_neq(state, sentlsf_alloc(tlsf, SENTLSF_DEFAULT_CHUNK_SIZE / 2), NULL);
+        sentest_assert_eq(state, tlsf->chunks, chunks);
+      }
+      sentlsf_free(tlsf);
+      free(sizes);
+      free(objects);
+    }
+  }
+}
@@ -11,6 +11,10 @@
 #include "../sensible-test/test/suite.h"
 #include "../sensible-data-structures/sensible-bitvec/test/suite.h"
 #include "../sensible-allocators/sensible-arena/test/suite.h"
+#include "../sensible-allocators/sensible-pool/test/suite.h"
+#include "../sensible-allocators/sensible-slab/test/suite.h"
+#include "../sensible-allocators/sensible-stack/test/suite.h"
+#include "../sensible-allocators/sensible-tlsf/test/suite.h"
 #include "../sensible-timing/test/suite.h"
 #include "../sensible-args/test/suite.h"
 
@@ -39,6 +43,10 @@ int main(int argc, char **argv) {
   run_sensible_test_suite(state);
   run_sensible_bitvec_suite(state);
   run_sensible_arena_suite(state);
+  run_sensible_pool_suite(state);
+  run_sensible_slab_suite(state);
+  run_sensible_stack_suite(state);
+  run_sensible_tlsf_suite(state);
   run_sensible_timing_suite(state);
   run_sensible_args_suite(state);
   return sentest_finish(state);